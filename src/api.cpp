@@ -3,6 +3,8 @@
 #include "engine.h"
 #include "log/logger_manager.h"
 #include "memory/memory_manager.h"
+#include "memory/memory_resource.h"
+#include "memory/small_object_allocator.h"
 
 namespace ecs
 {
@@ -31,6 +33,17 @@ namespace internal
 
 MemoryManager* ecsMemoryManager = new memory::internal::MemoryManager();
 
+SmallObjectAllocator* ecsSmallObjectAllocator = new memory::internal::SmallObjectAllocator();
+
+std::pmr::memory_resource* GetInternalMemoryResource()
+{
+    // containers of other static objects may be created before the memory manager
+    if (ecsMemoryManager == nullptr)
+        return std::pmr::new_delete_resource();
+
+    return ecsMemoryManager->GetInternalMemoryResource();
+}
+
 } // namespace internal
 
 GlobalMemoryUser::GlobalMemoryUser()
@@ -43,11 +56,21 @@ const void* GlobalMemoryUser::Allocate(std::size_t memSize, const char* user)
     return ecsMemoryManager->Allocate(memSize, user);
 }
 
+const void* GlobalMemoryUser::AllocateChunk(std::size_t memSize, const char* user, u32 numaNode)
+{
+    return ecsMemoryManager->AllocateChunk(memSize, user, numaNode);
+}
+
 void GlobalMemoryUser::Free(void* pMem)
 {
     ecsMemoryManager->Free(pMem);
 }
 
+u32 GlobalMemoryUser::GetNumaNodeCount() const
+{
+    return ecsMemoryManager->GetNumaNodeCount();
+}
+
 } // namespace memory
 
 EcsEngine* ecsEngine = nullptr; // new ECSEngine();
@@ -58,6 +81,14 @@ void Initialize()
         ecsEngine = new EcsEngine();
 }
 
+void Initialize(const memory::MemoryConfig& memoryConfig)
+{
+    if (ecsEngine == nullptr)
+        memory::internal::ecsMemoryManager->Configure(memoryConfig);
+
+    Initialize();
+}
+
 void Terminate()
 {
     if (ecsEngine != nullptr)
@@ -66,6 +97,9 @@ void Terminate()
         ecsEngine = nullptr;
     }
 
+    // give the small objects' slabs of the library back before looking for leaks
+    memory::internal::ecsSmallObjectAllocator->Trim();
+
     // check for memory leaks
     memory::internal::ecsMemoryManager->CheckMemoryLeaks();
 }
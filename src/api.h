@@ -4,8 +4,13 @@
 #define ENITY_T_CHUNK_SIZE 512
 #define COMPONENT_LUT_GROW 1024
 #define COMPONENT_T_CHUNK_SIZE 512
-#define ECS_EVENT_MEMORY_BUFFER_SIZE 4194304  // 4MB
+#define ECS_EVENT_MEMORY_BUFFER_SIZE 4194304  // 4MB, size of each of the two event buffers and of every grown block
 #define ECS_SYSTEM_MEMORY_BUFFER_SIZE 8388608 // 8MB
+#define ECS_EVENT_TIMER_RESOLUTION_MS 1.0     // granularity of delayed events
+#define ECS_FRAME_MEMORY_BUFFER_SIZE 1048576  // 1MB of frame scratch memory per thread
+#define ECS_SMALL_OBJECT_SLAB_SIZE 65536      // 64KB, memory of each small object pool
+#define ECS_CHUNK_MAX_EMPTY_CHUNKS 4          // empty chunks of a type that make it release some
+#define ECS_CHUNK_KEEP_EMPTY_CHUNKS 1         // empty chunks of a type left after that
 
 #include "log/logger.h"
 #include "log/logger_manager.h"
@@ -34,10 +39,15 @@ ECS_API log::Logger* GetLogger(const char* logger);
 
 namespace memory
 {
+struct MemoryConfig;
+
 namespace internal
 {
 class MemoryManager;
 ECS_API extern MemoryManager* ecsMemoryManager;
+
+class SmallObjectAllocator;
+ECS_API extern SmallObjectAllocator* ecsSmallObjectAllocator;
 } // namespace internal
 } // namespace memory
 
@@ -65,7 +75,12 @@ public:
     virtual ~GlobalMemoryUser() = default;
 
     const void* Allocate(std::size_t memSize, const char* user = nullptr);
+    // Allocates from the chunk memory of a NUMA node, see MemoryConfig.
+    const void* AllocateChunk(std::size_t memSize, const char* user = nullptr, u32 numaNode = 0);
     void        Free(void* pMem);
+
+    // Nodes the chunk memory is split between.
+    u32 GetNumaNodeCount() const;
 };
 
 } // namespace memory
@@ -73,6 +88,7 @@ public:
 class EcsEngine;
 ECS_API extern EcsEngine* ecsEngine;
 ECS_API void              Initialize();
+ECS_API void              Initialize(const memory::MemoryConfig& memoryConfig);
 ECS_API void              Terminate();
 
 } // namespace ecs
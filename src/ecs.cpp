@@ -54,10 +54,51 @@ void ComponentManager::RemoveAllComponents(const EntityId entityId)
     }
 }
 
+util::HashValue ComponentManager::ComputeStateHash() const
+{
+    memory::internal::Vector<ComponentTypeId> componentTypeIds;
+    componentTypeIds.reserve(this->componentContainerRegistry.size());
+    for (const auto& cc : this->componentContainerRegistry)
+        componentTypeIds.push_back(cc.first);
+
+    // registry iteration order is unspecified
+    std::sort(componentTypeIds.begin(), componentTypeIds.end());
+
+    util::HashValue hash = 0;
+    for (ComponentTypeId componentTypeId : componentTypeIds)
+    {
+        hash = util::HashCombine(hash, componentTypeId);
+        hash = this->componentContainerRegistry.at(componentTypeId)->HashComponents(hash);
+    }
+
+    return hash;
+}
+
+void ComponentManager::GetMemoryStats(std::vector<memory::MemoryPoolStats>& stats) const
+{
+    for (const auto& cc : this->componentContainerRegistry)
+        stats.push_back(cc.second->GetMemoryStats());
+}
+
+void ComponentManager::ShrinkToFit()
+{
+    for (auto& cc : this->componentContainerRegistry)
+        cc.second->ShrinkToFit();
+}
+
+void ComponentManager::SetChunkReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy)
+{
+    this->chunkReleasePolicy = releasePolicy;
+
+    for (auto& cc : this->componentContainerRegistry)
+        cc.second->SetReleasePolicy(releasePolicy);
+}
+
 void ComponentManager::ReleaseComponentId(ComponentId id)
 {
     assert((id != INVALID_COMPONENT_ID && id < this->componentLookupTable.size()) && "Invalid component id");
-    this->componentLookupTable[id] = nullptr;
+    this->componentLookupTable[id]   = nullptr;
+    this->componentChunkModified[id] = nullptr;
 }
 
 void ComponentManager::MapEntityComponent(EntityId entityId, ComponentId componentId, ComponentTypeId componentTypeId)
@@ -138,6 +179,26 @@ EntityManager::EntityManager(ComponentManager* componentManagerInstance)
     LogInfo("Release EntityManager!")
 }
 
+void EntityManager::GetMemoryStats(std::vector<memory::MemoryPoolStats>& stats) const
+{
+    for (const auto& ec : this->entityRegistry)
+        stats.push_back(ec.second->GetMemoryStats());
+}
+
+void EntityManager::ShrinkToFit()
+{
+    for (auto& ec : this->entityRegistry)
+        ec.second->ShrinkToFit();
+}
+
+void EntityManager::SetChunkReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy)
+{
+    this->chunkReleasePolicy = releasePolicy;
+
+    for (auto& ec : this->entityRegistry)
+        ec.second->SetReleasePolicy(releasePolicy);
+}
+
 EntityId EntityManager::AqcuireEntityId(IEntity* entity)
 {
     return this->entityHandleTable.AqcuireHandle(entity);
@@ -264,11 +325,11 @@ void SystemManager::UpdateSystemWorkOrder()
 {
     // depth-first-search function
     static const std::function<void(
-        SystemTypeId, std::vector<int>&, const std::vector<std::vector<bool>>&, std::vector<SystemTypeId>&)>
-        dfs = [&](SystemTypeId                          vertex,
-                  std::vector<int>&                     vertexState,
-                  const std::vector<std::vector<bool>>& edges,
-                  std::vector<SystemTypeId>&            output)
+        SystemTypeId, std::vector<int>&, const SystemDependencyMatrix&, std::vector<SystemTypeId>&)>
+        dfs = [&](SystemTypeId                  vertex,
+                  std::vector<int>&             vertexState,
+                  const SystemDependencyMatrix& edges,
+                  std::vector<SystemTypeId>&    output)
     {
         vertexState[vertex] = 1; // visited
 
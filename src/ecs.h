@@ -8,9 +8,12 @@
 
 #include "util/family_type_id.h"
 #include "util/handle.h"
+#include "util/hash.h"
+#include "util/thread_pool.h"
 
 #include "memory/allocators/linear_allocator.h"
 #include "memory/memory_chunk_allocator.h"
+#include "memory/memory_resource.h"
 
 namespace ecs
 {
@@ -72,6 +75,20 @@ public:
 template <typename T>
 const ComponentTypeId Component<T>::STATIC_COMPONENT_TYPE_ID = util::internal::FamilyTypeID<IComponent>::Get<T>();
 
+/**
+ * Specialize for a component type whose memory doesn't hash the same in every process, e.g. one with a second
+ * polymorphic base (its vtable pointer is hashed) or one holding pointers. Hash only its simulation state, e.g.
+ * template <> struct ComponentStateHash<Unit> : std::true_type
+ * {
+ *     static util::HashValue Hash(const Unit* unit, util::HashValue seed) { return util::HashCombine(seed, unit->hp); }
+ * };
+ * By default a component's memory is hashed without the vtable pointer of IComponent, which has to be its only one.
+ */
+template <typename T>
+struct ComponentStateHash : std::false_type
+{
+};
+
 class ECS_API ComponentManager : memory::GlobalMemoryUser
 {
     friend class IComponent;
@@ -85,12 +102,23 @@ class ECS_API ComponentManager : memory::GlobalMemoryUser
         virtual const char* GetComponentContainerTypeName() const = 0;
 
         virtual void DestroyComponent(IComponent* object) = 0;
+
+        virtual util::HashValue HashComponents(util::HashValue seed) const = 0;
+
+        virtual memory::MemoryPoolStats GetMemoryStats() const = 0;
+
+        virtual void ShrinkToFit() = 0;
+
+        virtual void SetReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy) = 0;
     };
 
     template <typename T>
     class ComponentContainer : public memory::MemoryChunkAllocator<T, COMPONENT_T_CHUNK_SIZE>,
                                public IComponentContainer
     {
+        using Allocator   = memory::MemoryChunkAllocator<T, COMPONENT_T_CHUNK_SIZE>;
+        using MemoryChunk = typename Allocator::MemoryChunk;
+
         ComponentContainer(const ComponentContainer&) = delete;
         ComponentContainer& operator=(ComponentContainer&) = delete;
 
@@ -115,6 +143,88 @@ class ECS_API ComponentManager : memory::GlobalMemoryUser
             this->DestroyObject(object);
         }
 
+        // Creates the memory of a component, chunkModified is set to the modified flag of the chunk holding it.
+        void* CreateComponent(std::atomic<bool>*& chunkModified)
+        {
+            MemoryChunk* chunk  = nullptr;
+            void*        object = this->CreateObject(chunk);
+            chunkModified       = &chunk->modified;
+            return object;
+        }
+
+        virtual util::HashValue HashComponents(util::HashValue seed) const override
+        {
+            util::HashValue hash = seed;
+            for (auto chunk : this->chunks)
+            {
+                if (chunk->objects.empty() == true)
+                    continue;
+
+                // chunks nothing was written to since the last call keep their hash
+                if (chunk->modified.exchange(false, std::memory_order_relaxed) == true)
+                    chunk->stateHash = HashChunk(chunk);
+
+                hash = util::HashCombine(hash, chunk->stateHash);
+            }
+            return hash;
+        }
+
+        static util::HashValue HashChunk(const MemoryChunk* chunk)
+        {
+            util::HashValue hash = 0;
+            if constexpr (ComponentStateHash<T>::value == true)
+            {
+                chunk->ForEachObjectInSlotOrder(
+                    [&](const T* object) { hash = ComponentStateHash<T>::Hash(object, hash); });
+            }
+            else
+            {
+                // one stream per chunk, the vtable pointer is skipped, its value differs between processes
+                static constexpr std::size_t OFFSET = sizeof(void*);
+
+                util::HashStream stream(hash);
+                chunk->ForEachObjectInSlotOrder(
+                    [&](const T* object)
+                    {
+                        assert(static_cast<const void*>(static_cast<const IComponent*>(object)) == object &&
+                               "IComponent is not the first base, specialize ComponentStateHash.");
+                        stream.Update(reinterpret_cast<const u8*>(object) + OFFSET, sizeof(T) - OFFSET);
+                    });
+                hash = stream.Finalize();
+            }
+            return hash;
+        }
+
+        virtual memory::MemoryPoolStats GetMemoryStats() const override
+        {
+            memory::MemoryPoolStats stats = this->GetChunkStats();
+            stats.typeName                = this->GetComponentContainerTypeName();
+            return stats;
+        }
+
+        virtual void ShrinkToFit() override { Allocator::ShrinkToFit(); }
+
+        virtual void SetReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy) override
+        {
+            Allocator::SetReleasePolicy(releasePolicy);
+        }
+
+        // one job per chunk, run on the NUMA node holding the chunk if possible
+        template <class F>
+        void ParallelForEach(util::ThreadPool* threadPool, const F& func)
+        {
+            const memory::internal::Vector<MemoryChunk*> jobChunks(this->chunks.begin(), this->chunks.end());
+
+            threadPool->ParallelFor(
+                jobChunks.size(),
+                [&](std::size_t i) {
+                    jobChunks[i]->modified.store(true, std::memory_order_relaxed);
+                    for (T* object : jobChunks[i]->objects)
+                        func(object);
+                },
+                [&](std::size_t i) { return jobChunks[i]->numaNode; });
+        }
+
     }; // class ComponentContainer
 
 public:
@@ -138,9 +248,14 @@ public:
         const ComponentTypeId CTID = T::STATIC_COMPONENT_TYPE_ID;
 
         // aqcuire memory for new component object of type T
-        void* pObjectMemory = GetComponentContainer<T>()->CreateObject();
+        std::atomic<bool>* chunkModified = nullptr;
+        void*              pObjectMemory = GetComponentContainer<T>()->CreateComponent(chunkModified);
 
-        ComponentId componentId          = this->AqcuireComponentId((T*)pObjectMemory);
+        // padding bytes are never written by the constructor, clear them so state hashes are reproducible, also for
+        // components created before deterministic mode was enabled
+        std::memset(pObjectMemory, 0, sizeof(T));
+
+        ComponentId componentId          = this->AqcuireComponentId((T*)pObjectMemory, chunkModified);
         ((T*)pObjectMemory)->componentId = componentId;
 
         // create component inplace
@@ -187,9 +302,70 @@ public:
         if (componentId == INVALID_COMPONENT_ID)
             return nullptr;
 
+        // the component may be written through the returned pointer
+        this->componentChunkModified[componentId]->store(true, std::memory_order_relaxed);
+
         return static_cast<T*>(this->componentLookupTable[componentId]);
     }
 
+    /**
+     * Computes a hash over the memory of all live components. Component types are visited in type id order and
+     * components in chunk order, so equal worlds produce equal hashes across runs. The vtable pointer of each
+     * component is skipped; components holding pointers to external memory only hash the pointer value.
+     * The hash of a chunk is cached until a component of it is added, removed or handed out by GetComponent, the
+     * component iterators or ParallelForEach, so only chunks touched since the last call are hashed again. Writes
+     * through a component pointer kept from before the last call go unnoticed, fetch components again each tick.
+     * @return The world state hash.
+     */
+    util::HashValue ComputeStateHash() const;
+
+    // Appends the memory of each component type.
+    void GetMemoryStats(std::vector<memory::MemoryPoolStats>& stats) const;
+
+    /**
+     * Allocates chunks for numComponents components of type T up front, e.g. before a known spawn wave. The chunks
+     * are kept until the next reservation or ShrinkToFit, even if they are empty.
+     * @param numComponents - The number of components.
+     */
+    template <typename T>
+    inline void Reserve(std::size_t numComponents)
+    {
+        GetComponentContainer<T>()->Reserve(numComponents);
+    }
+
+    /**
+     * Gives the empty chunks of components of type T back to the global memory and drops their reservation.
+     */
+    template <typename T>
+    inline void ShrinkToFit()
+    {
+        GetComponentContainer<T>()->ShrinkToFit();
+    }
+
+    // Gives the empty chunks of all component types back.
+    void ShrinkToFit();
+
+    /**
+     * Sets when the chunks of all component types are given back without a call to ShrinkToFit.
+     * @param releasePolicy - The release policy.
+     */
+    void SetChunkReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy);
+
+    inline const memory::ChunkReleasePolicy& GetChunkReleasePolicy() const { return this->chunkReleasePolicy; }
+
+    /**
+     * Calls func(T*) for every component of type T, spread over the jobs of a thread pool by chunk. A chunk is
+     * preferably processed by a worker on the NUMA node holding its memory, see memory::MemoryConfig::numaAware.
+     * Components must not be added or removed until it returns.
+     * @param threadPool - The thread pool, e.g. EcsEngine::GetThreadPool.
+     * @param func - The function, called concurrently.
+     */
+    template <typename T, class F>
+    inline void ParallelForEach(util::ThreadPool* threadPool, const F& func)
+    {
+        GetComponentContainer<T>()->ParallelForEach(threadPool, func);
+    }
+
     template <typename T>
     inline TComponentIterator<T> begin()
     {
@@ -215,6 +391,7 @@ private:
         {
             cc                                                = new ComponentContainer<T>();
             this->componentContainerRegistry[componentTypeId] = cc;
+            cc->SetReleasePolicy(this->chunkReleasePolicy);
         }
         else
             cc = static_cast<ComponentContainer<T>*>(it->second);
@@ -223,22 +400,25 @@ private:
         return cc;
     }
 
-    ComponentId AqcuireComponentId(IComponent* component)
+    ComponentId AqcuireComponentId(IComponent* component, std::atomic<bool>* chunkModified)
     {
         int i = 0;
         for (; i < this->componentLookupTable.size(); ++i)
         {
             if (this->componentLookupTable[i] == nullptr)
             {
-                this->componentLookupTable[i] = component;
+                this->componentLookupTable[i]   = component;
+                this->componentChunkModified[i] = chunkModified;
                 return i;
             }
         }
 
         // increase component LUT size
         this->componentLookupTable.resize(this->componentLookupTable.size() + COMPONENT_LUT_GROW, nullptr);
+        this->componentChunkModified.resize(this->componentLookupTable.size(), nullptr);
 
-        this->componentLookupTable[i] = component;
+        this->componentLookupTable[i]   = component;
+        this->componentChunkModified[i] = chunkModified;
         return i;
     }
 
@@ -249,15 +429,20 @@ private:
     void UnmapEntityComponent(EntityId entityId, ComponentId componentId, ComponentTypeId componentTypeId);
 
 private:
-    using ComponentContainerRegistry = std::unordered_map<ComponentTypeId, IComponentContainer*>;
+    using ComponentContainerRegistry = memory::internal::UnorderedMap<ComponentTypeId, IComponentContainer*>;
     ComponentContainerRegistry componentContainerRegistry;
 
-    using ComponentLookupTable = std::vector<IComponent*>;
+    using ComponentLookupTable = memory::internal::Vector<IComponent*>;
     ComponentLookupTable componentLookupTable;
 
-    using EntityComponentMap = std::vector<std::vector<ComponentId>>;
+    // modified flag of the chunk holding each component, indexed like componentLookupTable
+    memory::internal::Vector<std::atomic<bool>*> componentChunkModified;
+
+    using EntityComponentMap = memory::internal::Vector<memory::internal::Vector<ComponentId>>;
     EntityComponentMap entityComponentMap;
 
+    memory::ChunkReleasePolicy chunkReleasePolicy;
+
 }; // ComponentManager
 
 class ECS_API IEntity
@@ -354,11 +539,19 @@ class ECS_API EntityManager
         virtual const char* GetEntityContainerTypeName() const = 0;
 
         virtual void DestroyEntity(IEntity* object) = 0;
+
+        virtual memory::MemoryPoolStats GetMemoryStats() const = 0;
+
+        virtual void ShrinkToFit() = 0;
+
+        virtual void SetReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy) = 0;
     }; // class IEntityContainer
 
     template <typename T>
     class EntityContainer : public memory::MemoryChunkAllocator<T, ENITY_T_CHUNK_SIZE>, public IEntityContainer
     {
+        using Allocator = memory::MemoryChunkAllocator<T, ENITY_T_CHUNK_SIZE>;
+
     public:
         EntityContainer()
             : memory::MemoryChunkAllocator<T, ENITY_T_CHUNK_SIZE>("EntityManager")
@@ -383,6 +576,20 @@ class ECS_API EntityManager
             this->DestroyObject(object);
         }
 
+        virtual memory::MemoryPoolStats GetMemoryStats() const override
+        {
+            memory::MemoryPoolStats stats = this->GetChunkStats();
+            stats.typeName                = this->GetEntityContainerTypeName();
+            return stats;
+        }
+
+        virtual void ShrinkToFit() override { Allocator::ShrinkToFit(); }
+
+        virtual void SetReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy) override
+        {
+            Allocator::SetReleasePolicy(releasePolicy);
+        }
+
     }; // EntityContainer
 
 public:
@@ -423,6 +630,42 @@ public:
 
     void RemoveDestroyedEntities();
 
+    inline bool HasPendingDestroyedEntities() const { return this->numPendingDestroyedEntities > 0; }
+
+    // Appends the memory of each entity type.
+    void GetMemoryStats(std::vector<memory::MemoryPoolStats>& stats) const;
+
+    /**
+     * Allocates chunks for numEntities entities of type T up front, e.g. before a known spawn wave. The chunks are
+     * kept until the next reservation or ShrinkToFit, even if they are empty.
+     * @param numEntities - The number of entities.
+     */
+    template <typename T>
+    inline void Reserve(std::size_t numEntities)
+    {
+        GetEntityContainer<T>()->Reserve(numEntities);
+    }
+
+    /**
+     * Gives the empty chunks of entities of type T back to the global memory and drops their reservation.
+     */
+    template <typename T>
+    inline void ShrinkToFit()
+    {
+        GetEntityContainer<T>()->ShrinkToFit();
+    }
+
+    // Gives the empty chunks of all entity types back.
+    void ShrinkToFit();
+
+    /**
+     * Sets when the chunks of all entity types are given back without a call to ShrinkToFit.
+     * @param releasePolicy - The release policy.
+     */
+    void SetChunkReleasePolicy(const memory::ChunkReleasePolicy& releasePolicy);
+
+    inline const memory::ChunkReleasePolicy& GetChunkReleasePolicy() const { return this->chunkReleasePolicy; }
+
 private:
     template <typename T>
     inline EntityContainer<T>* GetEntityContainer()
@@ -436,6 +679,7 @@ private:
         {
             ec                        = new EntityContainer<T>();
             this->entityRegistry[EID] = ec;
+            ec->SetReleasePolicy(this->chunkReleasePolicy);
         }
         else
             ec = (EntityContainer<T>*)it->second;
@@ -449,13 +693,14 @@ private:
     void ReleaseEntityId(EntityId id);
 
 private:
-    using EntityRegistry           = std::unordered_map<EntityTypeId, IEntityContainer*>;
-    using PendingDestroyedEntities = std::vector<EntityId>;
+    using EntityRegistry           = memory::internal::UnorderedMap<EntityTypeId, IEntityContainer*>;
+    using PendingDestroyedEntities = memory::internal::Vector<EntityId>;
     EntityRegistry           entityRegistry;
     PendingDestroyedEntities pendingDestroyedEntities;
     std::size_t              numPendingDestroyedEntities;
-    ComponentManager*        componentManager;
-    EntityHandleTable        entityHandleTable;
+    ComponentManager*          componentManager;
+    EntityHandleTable          entityHandleTable;
+    memory::ChunkReleasePolicy chunkReleasePolicy;
 };
 
 template <typename T>
@@ -515,10 +760,10 @@ class ECS_API SystemManager : memory::GlobalMemoryUser
     friend EcsEngine;
     DECLARE_LOGGER
 
-    using SystemDependencyMatrix = std::vector<std::vector<bool>>;
-    using SystemRegistry         = std::unordered_map<u64, ISystem*>;
+    using SystemDependencyMatrix = memory::internal::Vector<memory::internal::Vector<bool>>;
+    using SystemRegistry         = memory::internal::UnorderedMap<u64, ISystem*>;
     using SystemAllocator        = memory::allocator::LinearAllocator;
-    using SystemWorkOrder        = std::vector<ISystem*>;
+    using SystemWorkOrder        = memory::internal::Vector<ISystem*>;
 
 public:
     SystemManager();
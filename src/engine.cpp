@@ -4,18 +4,179 @@
 
 #include "event/event_handler.h"
 
+#include "memory/memory_manager.h"
+#include "memory/small_object_allocator.h"
+
 #include "util/timer.h"
 
+#include <cstdio>
+
 namespace ecs
 {
 
+namespace
+{
+
+// Summary:	Minimal JSON output, separators are inserted between the values of an object or array.
+class JsonWriter
+{
+public:
+    inline void BeginObject(const char* key = nullptr) { this->Begin(key, '{'); }
+    inline void EndObject() { this->End('}'); }
+    inline void BeginArray(const char* key) { this->Begin(key, '['); }
+    inline void EndArray() { this->End(']'); }
+
+    void Write(const char* key, const char* value)
+    {
+        this->Key(key);
+        this->json += '"';
+        for (const char* c = value; *c != '\0'; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                this->json += '\\';
+            this->json += *c;
+        }
+        this->json += '"';
+    }
+
+    void Write(const char* key, u64 value)
+    {
+        this->Key(key);
+        this->json += std::to_string(value);
+    }
+
+    void Write(const char* key, f64 value)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.4f", value);
+
+        this->Key(key);
+        this->json += buffer;
+    }
+
+    inline std::string& GetJson() { return this->json; }
+
+private:
+    void Key(const char* key)
+    {
+        if (this->empty == false)
+            this->json += ',';
+        this->empty = false;
+
+        if (key != nullptr)
+        {
+            this->json += '"';
+            this->json += key;
+            this->json += "\":";
+        }
+    }
+
+    void Begin(const char* key, char bracket)
+    {
+        this->Key(key);
+        this->json += bracket;
+        this->empty = true;
+    }
+
+    void End(char bracket)
+    {
+        this->json += bracket;
+        this->empty = false;
+    }
+
+private:
+    std::string json;
+    bool        empty = true;
+};
+
+void WriteArenaStats(JsonWriter& writer, const char* key, const memory::MemoryArenaStats& stats)
+{
+    writer.BeginObject(key);
+    writer.Write("reservedMemory", (u64)stats.reservedMemory);
+    writer.Write("committedMemory", (u64)stats.committedMemory);
+    writer.Write("usedMemory", (u64)stats.usedMemory);
+    writer.Write("peakUsedMemory", (u64)stats.peakUsedMemory);
+    writer.Write("freeMemory", (u64)stats.freeMemory);
+    writer.Write("largestFreeBlock", (u64)stats.largestFreeBlock);
+    writer.Write("fragmentation", stats.fragmentation);
+    writer.EndObject();
+}
+
+void WritePoolStats(JsonWriter& writer, const char* key, const std::vector<memory::MemoryPoolStats>& pools)
+{
+    writer.BeginArray(key);
+    for (const memory::MemoryPoolStats& stats : pools)
+    {
+        writer.BeginObject();
+        writer.Write("type", stats.typeName);
+        writer.Write("objectSize", (u64)stats.objectSize);
+        writer.Write("numObjects", (u64)stats.numObjects);
+        writer.Write("peakNumObjects", (u64)stats.peakNumObjects);
+        writer.Write("numChunks", (u64)stats.numChunks);
+        writer.Write("numEmptyChunks", (u64)stats.numEmptyChunks);
+        writer.Write("reservedMemory", (u64)stats.reservedMemory);
+        writer.Write("usedMemory", (u64)stats.usedMemory);
+        writer.Write("occupancy", stats.occupancy);
+        writer.EndObject();
+    }
+    writer.EndArray();
+}
+
+} // namespace
+
+std::string MemoryStatsToJson(const MemoryStats& stats)
+{
+    JsonWriter writer;
+    writer.BeginObject();
+
+    WriteArenaStats(writer, "globalMemory", stats.globalMemory);
+    WriteArenaStats(writer, "chunkMemory", stats.chunkMemory);
+    writer.Write("internalMemory", (u64)stats.internalMemory);
+    writer.Write("smallObjectMemory", (u64)stats.smallObjectMemory);
+
+    writer.BeginArray("tags");
+    for (const memory::MemoryTagStats& tag : stats.tags)
+    {
+        writer.BeginObject();
+        writer.Write("tag", tag.tag);
+        writer.Write("usedMemory", (u64)tag.usedMemory);
+        writer.Write("peakUsedMemory", (u64)tag.peakUsedMemory);
+        writer.Write("numAllocations", (u64)tag.numAllocations);
+        writer.EndObject();
+    }
+    writer.EndArray();
+
+    WritePoolStats(writer, "components", stats.components);
+    WritePoolStats(writer, "entities", stats.entities);
+
+    writer.BeginObject("events");
+    writer.Write("usedMemory", (u64)stats.events.usedMemory);
+    writer.Write("peakUsedMemory", (u64)stats.events.peakUsedMemory);
+    writer.Write("reservedMemory", (u64)stats.events.reservedMemory);
+    writer.Write("numBlocks", (u64)stats.events.numBlocks);
+    writer.Write("numDroppedEvents", stats.events.numDroppedEvents);
+    writer.Write("numFlushes", stats.events.numFlushes);
+    writer.Write("numCoalescedEvents", stats.events.numCoalescedEvents);
+    writer.EndObject();
+
+    writer.EndObject();
+    return std::move(writer.GetJson());
+}
+
 EcsEngine::EcsEngine()
+    : ecsThreadPool(nullptr)
+    , deterministic(false)
+    , worldStateHash(0)
+    , frameCount(0)
 {
     ecsEngineTime       = new util::Timer();
     ecsEventHandler     = new event::EventHandler();
     ecsSystemManager    = new SystemManager();
     ecsComponentManager = new ComponentManager();
     ecsEntityManager    = new EntityManager(this->ecsComponentManager);
+
+    this->frameAllocators.push_back(new memory::FrameAllocator(ECS_FRAME_MEMORY_BUFFER_SIZE));
+    this->engineThreadId = std::this_thread::get_id();
 }
 
 EcsEngine::~EcsEngine()
@@ -32,27 +193,152 @@ EcsEngine::~EcsEngine()
     delete ecsEventHandler;
     ecsEventHandler = nullptr;
 
+    delete ecsThreadPool;
+    ecsThreadPool = nullptr;
+
+    for (auto frameAllocator : this->frameAllocators)
+    {
+        delete frameAllocator;
+    }
+    this->frameAllocators.clear();
+
     delete ecsEngineTime;
     ecsEngineTime = nullptr;
 }
 
 void EcsEngine::Update(f32 tick_ms)
+{
+    this->Tick(tick_ms);
+}
+
+SimulationStats EcsEngine::Simulate(u64 frames, f32 tick_ms)
+{
+#if !ECS_DISABLE_LOGGING
+    // per event trace output dominates a headless run, keep warnings and errors only
+    log::internal::LoggerManager* loggerManager = log::internal::ecsLoggerManager;
+    const log4cplus::LogLevel     logLevel      = loggerManager != nullptr ? loggerManager->GetLogLevel() : 0;
+    if (loggerManager != nullptr)
+        loggerManager->SetLogLevel(log4cplus::WARN_LOG_LEVEL);
+#endif
+
+    const auto start = std::chrono::steady_clock::now();
+
+    for (u64 frame = 0; frame < frames; ++frame)
+    {
+        this->Tick(tick_ms);
+    }
+
+    const std::chrono::duration<f64, std::milli> wall = std::chrono::steady_clock::now() - start;
+
+#if !ECS_DISABLE_LOGGING
+    if (loggerManager != nullptr)
+        loggerManager->SetLogLevel(logLevel);
+#endif
+
+    SimulationStats stats;
+    stats.frames          = frames;
+    stats.simulatedMS     = static_cast<f64>(tick_ms) * static_cast<f64>(frames);
+    stats.wallMS          = wall.count();
+    stats.framesPerSecond = stats.wallMS > 0.0 ? static_cast<f64>(frames) * 1000.0 / stats.wallMS : 0.0;
+    return stats;
+}
+
+void EcsEngine::Tick(f32 tick_ms)
 {
     // Advance engine time
     ecsEngineTime->Tick(tick_ms);
+    ecsEventHandler->SetTick(++this->frameCount);
+    ecsEventHandler->AdvanceDelayedEvents(tick_ms);
 
     // Update all running systems
     ecsSystemManager->Update(tick_ms);
-    ecsEventHandler->DispatchEvents();
+    if (ecsEventHandler->HasPendingEvents())
+        ecsEventHandler->DispatchEvents();
 
     // Finalize pending destroyed entities
-    ecsEntityManager->RemoveDestroyedEntities();
-    ecsEventHandler->DispatchEvents();
+    if (ecsEntityManager->HasPendingDestroyedEntities())
+    {
+        ecsEntityManager->RemoveDestroyedEntities();
+    }
+    if (ecsEventHandler->HasPendingEvents())
+        ecsEventHandler->DispatchEvents();
+
+    if (this->deterministic == true)
+        this->worldStateHash = ecsComponentManager->ComputeStateHash();
+
+    // Release frame scratch memory
+    for (auto frameAllocator : this->frameAllocators)
+    {
+        frameAllocator->Reset();
+    }
+}
+
+util::ThreadPool* EcsEngine::GetThreadPool()
+{
+    if (ecsThreadPool == nullptr)
+    {
+        const std::size_t numThreads = std::thread::hardware_concurrency();
+        const bool        numaAware  = memory::internal::ecsMemoryManager->GetNumaNodeCount() > 1;
+        ecsThreadPool                = new util::ThreadPool(numThreads > 1 ? numThreads - 1 : 0, numaAware);
+
+        while (this->frameAllocators.size() <= ecsThreadPool->GetWorkerCount())
+        {
+            this->frameAllocators.push_back(new memory::FrameAllocator(ECS_FRAME_MEMORY_BUFFER_SIZE));
+        }
+    }
+
+    return ecsThreadPool;
+}
+
+memory::FrameAllocator* EcsEngine::GetFrameAllocator()
+{
+    // worker indices are only unique within a pool, threads outside of it all have index 0
+    const util::ThreadPool* threadPool = util::ThreadPool::GetCurrentThreadPool();
+    const bool              engineThread =
+        threadPool != nullptr ? threadPool == ecsThreadPool : std::this_thread::get_id() == this->engineThreadId;
+
+    assert(engineThread == true && "Frame memory is only available to the engine's threads.");
+    if (engineThread == false)
+    {
+        return nullptr;
+    }
+
+    return this->frameAllocators[util::ThreadPool::GetCurrentWorkerIndex()];
+}
+
+MemoryStats EcsEngine::GetMemoryStats()
+{
+    memory::internal::MemoryManager* memoryManager = memory::internal::ecsMemoryManager;
+
+    MemoryStats stats;
+    stats.globalMemory      = memoryManager->GetGlobalMemoryStats();
+    stats.chunkMemory       = memoryManager->GetChunkMemoryStats();
+    stats.internalMemory    = memoryManager->GetInternalMemory();
+    stats.smallObjectMemory = memory::internal::ecsSmallObjectAllocator->GetReservedMemory();
+    stats.events            = ecsEventHandler->GetMemoryStats();
+
+    memoryManager->GetTagStats(stats.tags);
+    ecsComponentManager->GetMemoryStats(stats.components);
+    ecsEntityManager->GetMemoryStats(stats.entities);
+
+    return stats;
+}
+
+void EcsEngine::SetParallelEventDispatch(bool parallel)
+{
+    ecsEventHandler->SetThreadPool(parallel ? this->GetThreadPool() : nullptr);
+}
+
+void EcsEngine::SetDeterministic(bool deterministic)
+{
+    this->deterministic = deterministic;
+    ecsEventHandler->SetConcurrentMergeOrder(deterministic ? event::EventMergeOrder::Stable
+                                                           : event::EventMergeOrder::Unordered);
 }
 
-void EcsEngine::UnsubscribeEvent(event::internal::IEventDelegate* eventDelegate)
+void EcsEngine::UnsubscribeEvent(const event::EventCallbackToken& token)
 {
-    ecsEventHandler->RemoveEventCallback(eventDelegate);
+    ecsEventHandler->RemoveEventCallback(token);
 }
 
 } // namespace ecs
@@ -5,6 +5,11 @@
 #include "event/event_delegate.h"
 #include "event/event_handler.h"
 
+#include "memory/frame_allocator.h"
+#include "memory/memory_stats.h"
+
+#include "util/hash.h"
+
 namespace ecs
 {
 namespace util
@@ -22,6 +27,42 @@ class EntityManager;
 class SystemManager;
 class ComponentManager;
 
+/**
+ * Aggregate throughput of an EcsEngine::Simulate run.
+ */
+struct SimulationStats
+{
+    u64 frames;
+    f64 simulatedMS;
+    f64 wallMS;
+    f64 framesPerSecond;
+};
+
+/**
+ * Memory usage of the library, see EcsEngine::GetMemoryStats.
+ */
+struct MemoryStats
+{
+    memory::MemoryArenaStats globalMemory;
+    memory::MemoryArenaStats chunkMemory;
+
+    // containers and small objects of the library, taken from the global memory
+    std::size_t internalMemory;
+    std::size_t smallObjectMemory;
+
+    std::vector<memory::MemoryTagStats>  tags;
+    std::vector<memory::MemoryPoolStats> components;
+    std::vector<memory::MemoryPoolStats> entities;
+    event::EventMemoryStats              events;
+};
+
+/**
+ * Formats memory stats as a JSON object.
+ * @param stats - The stats.
+ * @return The JSON text.
+ */
+ECS_API std::string MemoryStatsToJson(const MemoryStats& stats);
+
 class ECS_API EcsEngine
 {
     friend class IEntity;
@@ -45,8 +86,34 @@ private:
 public:
     inline EntityManager* GetEntityManager() { return ecsEntityManager; }
 
-    inline ComponentManager* GetComponentManager() { return ecsComponentManager; }
-    inline SystemManager*    GetSystemManager() { return ecsSystemManager; }
+    inline ComponentManager*    GetComponentManager() { return ecsComponentManager; }
+    inline SystemManager*       GetSystemManager() { return ecsSystemManager; }
+    inline event::EventHandler* GetEventHandler() { return ecsEventHandler; }
+
+    /**
+     * Returns the worker pool of the engine. It is created on first use with one worker less than there are
+     * hardware threads, the calling thread takes part in its jobs. If the chunk memory is split between NUMA nodes,
+     * the workers are pinned to the nodes in turn.
+     */
+    util::ThreadPool* GetThreadPool();
+
+    /**
+     * Returns the frame scratch memory of the calling thread, which must be the engine thread, i.e. the thread that
+     * initialized the engine, or a worker of the engine's pool. Returns nullptr for any other thread. All frame
+     * allocations are released at the end of every update.
+     */
+    memory::FrameAllocator* GetFrameAllocator();
+
+    /**
+     * Returns the frame scratch memory of the calling thread for std::pmr containers. The containers must not
+     * outlive the current update. Threads without frame memory, see GetFrameAllocator, get the default resource in
+     * release builds.
+     */
+    inline std::pmr::memory_resource* GetFrameMemoryResource()
+    {
+        memory::FrameAllocator* frameAllocator = this->GetFrameAllocator();
+        return frameAllocator != nullptr ? frameAllocator->GetMemoryResource() : std::pmr::get_default_resource();
+    }
 
     /**
      * Broadcasts an event.
@@ -60,27 +127,163 @@ public:
         ecsEventHandler->Send<E>(std::forward<Args>(args)...);
     }
 
+    /**
+     * Delivers an event to all listeners right away instead of at the next event dispatch.
+     * @tparam E - Type of the e.
+     * @tparam Args - Type of the arguments.
+     * @param args - Variable arguments providing [in,out] The event arguments.
+     */
+    template <typename E, typename... Args>
+    void SendEventImmediate(Args&&... args)
+    {
+        ecsEventHandler->SendImmediate<E>(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Broadcasts an event carrying variable length data. The data is copied into the event buffer and handed to the
+     * event constructor as an EventPayload, followed by args.
+     * @tparam E - Type of the e.
+     * @tparam Args - Type of the arguments.
+     * @param data - The payload data.
+     * @param size - The payload size in bytes.
+     * @param args - Variable arguments providing [in,out] The event arguments.
+     */
+    template <typename E, typename... Args>
+    void SendEventWithPayload(const void* data, std::size_t size, Args&&... args)
+    {
+        ecsEventHandler->SendWithPayload<E>(data, size, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Broadcasts an event from any thread. The event is delivered by the next event dispatch on the engine thread.
+     * @tparam E - Type of the e.
+     * @tparam Args - Type of the arguments.
+     * @param args - Variable arguments providing [in,out] The event arguments.
+     */
+    template <typename E, typename... Args>
+    void SendEventConcurrent(Args&&... args)
+    {
+        ecsEventHandler->SendConcurrent<E>(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Broadcasts an event after a delay of engine time. The event is delivered by the event dispatch of the update
+     * in which the delay has passed.
+     * @tparam E - Type of the e.
+     * @tparam Args - Type of the arguments.
+     * @param delayMS - The delay in milliseconds.
+     * @param args - Variable arguments providing [in,out] The event arguments.
+     * @return A handle to cancel the event with CancelDelayedEvent.
+     */
+    template <typename E, typename... Args>
+    event::DelayedEventHandle SendEventDelayed(f32 delayMS, Args&&... args)
+    {
+        return ecsEventHandler->SendDelayed<E>(delayMS, std::forward<Args>(args)...);
+    }
+
+    /**
+     * Cancels a delayed event that was not delivered yet.
+     * @param handle - The handle returned by SendEventDelayed.
+     * @return False if the event was already delivered or cancelled.
+     */
+    inline bool CancelDelayedEvent(event::DelayedEventHandle handle) { return ecsEventHandler->CancelDelayed(handle); }
+
+    /**
+     * Sets the merge key of the calling thread's event buffer. In deterministic mode concurrently sent events are
+     * delivered in ascending producer key order, e.g. use the job index.
+     * @param producerKey - The producer key.
+     */
+    inline void SetEventProducerKey(u32 producerKey) { ecsEventHandler->SetThreadProducerKey(producerKey); }
+
     /**
      * Updates the entire ECS with a given delta time in milliseconds.
      * @param tickMS - The tick in milliseconds.
      */
     void Update(f32 tickMS);
 
+    /**
+     * Runs a headless batch of frames with a fixed delta time. Event dispatch and entity cleanup are skipped for
+     * frames that have nothing pending, and log output below warning level is suppressed for the duration of the run.
+     * @param frames - Number of frames to simulate.
+     * @param tickMS - The tick of each frame in milliseconds.
+     * @return Aggregate throughput of the run.
+     */
+    SimulationStats Simulate(u64 frames, f32 tickMS);
+
+    /**
+     * Dispatches the event queues of different dispatch groups concurrently on the worker pool, see
+     * event::EventDispatchGroup. Event types without a group are still dispatched on the calling thread.
+     * @param parallel - True to enable parallel event dispatch.
+     */
+    void SetParallelEventDispatch(bool parallel);
+
+    /**
+     * Enables deterministic (lockstep) mode. Events sent from other threads are merged in stable producer key order
+     * and a hash of all component memory is computed at the end of every tick, only rehashing the chunks that were
+     * touched, see ComponentManager::ComputeStateHash. Component memory is always cleared before construction, so
+     * the mode may be enabled after the first entities were created. See ComponentStateHash for components whose
+     * memory differs between processes.
+     * @param deterministic - True to enable deterministic mode.
+     */
+    void SetDeterministic(bool deterministic);
+
+    inline bool IsDeterministic() const { return this->deterministic; }
+
+    /**
+     * Returns the world state hash computed at the end of the last tick. Only valid in deterministic mode.
+     */
+    inline util::HashValue GetWorldStateHash() const { return this->worldStateHash; }
+
+    /**
+     * Returns the number of updates run so far. Recorded events are tagged with it, see event::EventJournal.
+     */
+    inline u64 GetFrameCount() const { return this->frameCount; }
+
+    /**
+     * Collects the memory usage of the global memory, of each allocation tag and of each component and entity type.
+     * @return The memory stats.
+     */
+    MemoryStats GetMemoryStats();
+
+    /**
+     * Returns the current memory stats as JSON, see MemoryStatsToJson.
+     */
+    inline std::string DumpMemoryStats() { return MemoryStatsToJson(this->GetMemoryStats()); }
+
 private:
+    void Tick(f32 tickMS);
+
     // Add event callback
     template <class E>
-    inline void SubscribeEvent(event::internal::IEventDelegate* const eventDelegate)
+    inline event::EventCallbackToken SubscribeEvent(const event::internal::EventDelegate& eventDelegate)
     {
-        ecsEventHandler->AddEventCallback<E>(eventDelegate);
+        return ecsEventHandler->AddEventCallback<E>(eventDelegate);
+    }
+
+    // Add event callback for events of a single scope
+    template <class E>
+    inline event::EventCallbackToken SubscribeEvent(const event::internal::EventDelegate& eventDelegate,
+                                                    event::EventScopeId                   scope)
+    {
+        return ecsEventHandler->AddScopedEventCallback<E>(eventDelegate, scope);
     }
 
     // Remove event callback
-    void UnsubscribeEvent(event::internal::IEventDelegate* eventDelegate);
+    void UnsubscribeEvent(const event::EventCallbackToken& token);
 
     util::Timer*         ecsEngineTime;
     EntityManager*       ecsEntityManager;
     ComponentManager*    ecsComponentManager;
     SystemManager*       ecsSystemManager;
     event::EventHandler* ecsEventHandler;
+    util::ThreadPool*    ecsThreadPool;
+
+    // one per thread, indexed by util::ThreadPool::GetCurrentWorkerIndex, the first one is the engine thread's
+    memory::internal::Vector<memory::FrameAllocator*> frameAllocators;
+    std::thread::id                                   engineThreadId;
+
+    bool            deterministic;
+    util::HashValue worldStateHash;
+    u64             frameCount;
 };
 } // namespace ecs
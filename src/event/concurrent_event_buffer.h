@@ -0,0 +1,170 @@
+#pragma once
+
+#include "api.h"
+
+#include "memory/allocators/iallocator.hpp"
+#include "memory/memory_resource.h"
+#include "memory/small_object.h"
+
+namespace ecs
+{
+namespace event
+{
+namespace internal
+{
+
+// moves a buffered event into the event handler and destroys the buffered copy
+using RelocateEventFunction = void (*)(EventHandler* eventHandler, void* event);
+
+// Summary:	Event buffer owned by a single producer thread. Events are
+// constructed in place behind a small record header and stay there until
+// the owning event handler merges the buffer on its own thread.
+class ECS_API ConcurrentEventBuffer : public memory::SmallObject
+{
+    static constexpr std::size_t BLOCK_SIZE = 65536;
+
+    struct RecordHeader
+    {
+        RelocateEventFunction relocate;
+        u32                   eventOffset;
+        u32                   recordSize;
+    };
+
+    // the block memory is taken from the internal memory resource and owned by the buffer
+    struct Block
+    {
+        u8*         memory;
+        std::size_t capacity;
+        std::size_t used;
+    };
+
+    using Blocks = memory::internal::Vector<Block>;
+
+public:
+    ConcurrentEventBuffer(u32 producerKey)
+        : currentBlock(0)
+        , eventCount(0)
+        , producerKey(producerKey)
+    {
+    }
+
+    ~ConcurrentEventBuffer()
+    {
+        for (Block& block : this->blocks)
+        {
+            FreeBlockMemory(block);
+        }
+    }
+
+    template <typename E, typename... Args>
+    void Push(RelocateEventFunction relocate, Args&&... eventArgs)
+    {
+        const std::size_t maxRecordSize = sizeof(RecordHeader) + alignof(E) + sizeof(E) + alignof(RecordHeader);
+
+        u8* record      = this->Reserve(maxRecordSize);
+        u8  adjustment  = memory::allocator::GetAdjustment(record + sizeof(RecordHeader), alignof(E));
+        u32 eventOffset = static_cast<u32>(sizeof(RecordHeader) + adjustment);
+
+        new (record + eventOffset) E(std::forward<Args>(eventArgs)...);
+
+        std::size_t recordSize = eventOffset + sizeof(E);
+        recordSize += memory::allocator::GetAdjustment(record + recordSize, alignof(RecordHeader));
+
+        RecordHeader* header = reinterpret_cast<RecordHeader*>(record);
+        header->relocate     = relocate;
+        header->eventOffset  = eventOffset;
+        header->recordSize   = static_cast<u32>(recordSize);
+
+        this->blocks[this->currentBlock].used += recordSize;
+        ++this->eventCount;
+    }
+
+    // Relocates all buffered events in the order they were pushed and resets the buffer.
+    void Relocate(EventHandler* eventHandler)
+    {
+        for (std::size_t i = 0; i < this->blocks.size() && i <= this->currentBlock; ++i)
+        {
+            Block&    block = this->blocks[i];
+            u8*       p     = block.memory;
+            u8* const end   = p + block.used;
+
+            while (p < end)
+            {
+                RecordHeader* header = reinterpret_cast<RecordHeader*>(p);
+                header->relocate(eventHandler, p + header->eventOffset);
+                p += header->recordSize;
+            }
+
+            block.used = 0;
+        }
+
+        this->currentBlock = 0;
+        this->eventCount   = 0;
+    }
+
+    // Exchanges the buffered events and blocks with other, the producer keys stay.
+    void SwapEvents(ConcurrentEventBuffer& other)
+    {
+        this->blocks.swap(other.blocks);
+        std::swap(this->currentBlock, other.currentBlock);
+        std::swap(this->eventCount, other.eventCount);
+    }
+
+    inline std::size_t GetEventCount() const { return this->eventCount; }
+
+    inline void SetProducerKey(u32 producerKey) { this->producerKey = producerKey; }
+    inline u32  GetProducerKey() const { return this->producerKey; }
+
+private:
+    ConcurrentEventBuffer(const ConcurrentEventBuffer&) = delete;
+    ConcurrentEventBuffer& operator=(const ConcurrentEventBuffer&) = delete;
+
+    u8* Reserve(std::size_t size)
+    {
+        while (this->currentBlock < this->blocks.size())
+        {
+            Block& block = this->blocks[this->currentBlock];
+            if (block.used + size <= block.capacity)
+            {
+                return block.memory + block.used;
+            }
+
+            if (block.used == 0)
+            {
+                // event does not fit into a standard block, replace it with a bigger one
+                FreeBlockMemory(block);
+                block.memory   = AllocateBlockMemory(size);
+                block.capacity = size;
+                return block.memory;
+            }
+
+            ++this->currentBlock;
+        }
+
+        const std::size_t capacity = std::max(size, BLOCK_SIZE);
+        this->blocks.push_back(Block{ AllocateBlockMemory(capacity), capacity, 0 });
+        this->currentBlock = this->blocks.size() - 1;
+
+        return this->blocks.back().memory;
+    }
+
+    static inline u8* AllocateBlockMemory(std::size_t size)
+    {
+        return static_cast<u8*>(memory::internal::GetInternalMemoryResource()->allocate(size, alignof(RecordHeader)));
+    }
+
+    static inline void FreeBlockMemory(Block& block)
+    {
+        memory::internal::GetInternalMemoryResource()->deallocate(block.memory, block.capacity, alignof(RecordHeader));
+    }
+
+private:
+    Blocks      blocks;
+    std::size_t currentBlock;
+    std::size_t eventCount;
+    u32         producerKey;
+};
+
+} // namespace internal
+} // namespace event
+} // namespace ecs
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <tuple>
+
+#include "api.h"
+#include "memory/small_object.h"
+
+namespace ecs
+{
+namespace event
+{
+
+class EventHandler;
+
+namespace internal
+{
+
+// Summary:	Pending delayed event. Holds the constructor arguments, the event is constructed and sent when the timer
+//			expires.
+class IDelayedEvent : public memory::SmallObject
+{
+public:
+    using SendFunction = void (*)(EventHandler*, IDelayedEvent*);
+
+    explicit IDelayedEvent(SendFunction send)
+        : send(send)
+    {
+    }
+
+    virtual ~IDelayedEvent() = default;
+
+    inline void Send(EventHandler* eventHandler) { this->send(eventHandler, this); }
+
+private:
+    SendFunction send;
+};
+
+template <typename E, typename... Args>
+class DelayedEvent : public IDelayedEvent
+{
+public:
+    template <typename... EventArgs>
+    explicit DelayedEvent(SendFunction send, EventArgs&&... eventArgs)
+        : IDelayedEvent(send)
+        , args(std::forward<EventArgs>(eventArgs)...)
+    {
+    }
+
+    std::tuple<Args...> args;
+};
+
+} // namespace internal
+} // namespace event
+} // namespace ecs
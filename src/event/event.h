@@ -4,6 +4,8 @@
 
 #include "event/ievent.h"
 
+#include "util/family_type_id.h"
+
 namespace ecs
 {
 namespace event
@@ -21,7 +23,7 @@ public:
 };
 
 template <typename T>
-const EventTypeId Event<T>::STATIC_EVENT_TYPE_ID{ typeid(T).hash_code() };
+const EventTypeId Event<T>::STATIC_EVENT_TYPE_ID{ util::internal::FamilyTypeID<IEvent>::Get<T>() };
 
 } // namespace event
 } // namespace ecs
@@ -0,0 +1,68 @@
+#include "event/event_arena.h"
+
+#include <cstddef>
+
+ecs::event::internal::EventArena::EventArena(std::size_t blockSize)
+    : blockSize(blockSize)
+    , currentBlock(0)
+    , usedMemory(0)
+    , reservedMemory(0)
+{
+    this->Grow(blockSize);
+}
+
+ecs::event::internal::EventArena::~EventArena()
+{
+    for (Block& block : this->blocks)
+    {
+        this->Free((void*)block.GetMemoryAddress());
+    }
+
+    this->blocks.clear();
+}
+
+void* ecs::event::internal::EventArena::Allocate(std::size_t size, u8 alignment)
+{
+    while (true)
+    {
+        Block&      block    = this->blocks[this->currentBlock];
+        std::size_t usedSize = block.GetUsedMemory();
+        void*       pMem     = block.Allocate(size, alignment);
+
+        if (pMem != nullptr)
+        {
+            this->usedMemory += block.GetUsedMemory() - usedSize;
+            return pMem;
+        }
+
+        if (this->currentBlock + 1 == this->blocks.size())
+        {
+            return nullptr;
+        }
+
+        ++this->currentBlock;
+    }
+}
+
+void ecs::event::internal::EventArena::Grow(std::size_t size)
+{
+    // leave room for the alignment adjustment
+    const std::size_t newBlockSize = std::max(this->blockSize, size + alignof(std::max_align_t));
+
+    this->blocks.emplace_back(newBlockSize, GlobalMemoryUser::Allocate(newBlockSize, "EventHandler"));
+    this->reservedMemory += newBlockSize;
+
+    // continue in the new block, skipping what is left in the current one
+    this->currentBlock = this->blocks.size() - 1;
+}
+
+void ecs::event::internal::EventArena::Clear()
+{
+    for (std::size_t i = 0; i < this->blocks.size() && i <= this->currentBlock; ++i)
+    {
+        this->blocks[i].Clear();
+    }
+
+    this->currentBlock = 0;
+    this->usedMemory   = 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "api.h"
+
+#include "memory/allocators/linear_allocator.h"
+#include "memory/memory_resource.h"
+
+namespace ecs
+{
+namespace event
+{
+namespace internal
+{
+
+// Summary:	Linear event memory made of a chain of blocks taken from the
+// global memory. The first block is acquired up front, further blocks are
+// only chained on request and kept for later frames once acquired.
+class ECS_API EventArena : memory::GlobalMemoryUser
+{
+    // held by value, calls on the final allocator type are inlined
+    using Block  = memory::allocator::LinearAllocator;
+    using Blocks = memory::internal::Vector<Block>;
+
+public:
+    EventArena(std::size_t blockSize);
+    ~EventArena();
+
+    // Allocates from the current block or the next already chained one, returns nullptr when all are full.
+    void* Allocate(std::size_t size, u8 alignment);
+
+    // Chains a new block that fits at least an allocation of size bytes.
+    void Grow(std::size_t size);
+
+    // Releases all allocations, chained blocks are kept.
+    void Clear();
+
+    inline std::size_t GetUsedMemory() const { return this->usedMemory; }
+    inline std::size_t GetReservedMemory() const { return this->reservedMemory; }
+    inline std::size_t GetBlockCount() const { return this->blocks.size(); }
+
+private:
+    EventArena(const EventArena&) = delete;
+    EventArena& operator=(const EventArena&) = delete;
+
+private:
+    const std::size_t blockSize;
+    Blocks            blocks;
+    std::size_t       currentBlock;
+    std::size_t       usedMemory;
+    std::size_t       reservedMemory;
+};
+
+} // namespace internal
+} // namespace event
+} // namespace ecs
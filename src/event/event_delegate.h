@@ -1,81 +1,121 @@
 #pragma once
 
-#include <typeinfo>
+#include <cstring>
 
 #include "api.h"
 
-#include "event/ievent_delegate.h"
+#include "event/ievent.h"
+#include "util/span.h"
 
 namespace ecs
 {
 namespace event
 {
 
-class IEvent;
+// Summary:	Handle of a registered event callback. A token stays valid until its callback is removed, after that it
+//			is rejected by the dispatcher even if the slot was reused.
+struct EventCallbackToken
+{
+    EventTypeId typeId;
+    u32         slot;
+    u32         version;
+};
+
+static const EventCallbackToken INVALID_EVENT_CALLBACK_TOKEN{ INVALID_EVENT_TYPE, 0, 0 };
 
 namespace internal
 {
 
-template <typename Class, typename EventType>
-class ECS_API EventDelegate : public IEventDelegate
+// Summary:	Raw bytes of a member function pointer. The size of member function pointers depends on the compiler and
+//			the class hierarchy, the buffer is large enough for virtual and multiple inheritance.
+struct MemberCallback
 {
-    typedef void (Class::*Callback)(const EventType* const);
+    static constexpr std::size_t MAX_SIZE = 4 * sizeof(void*);
+
+    alignas(void*) unsigned char bytes[MAX_SIZE];
 
-public:
-    EventDelegate(Class* receiver, Callback& callbackFunction)
-        : receiver(receiver)
-        , callback(callbackFunction)
+    template <typename Callback>
+    static inline MemberCallback Make(Callback callback)
     {
-    }
+        static_assert(sizeof(Callback) <= MAX_SIZE, "Member function pointer too large.");
 
-    virtual IEventDelegate* clone() override { return new EventDelegate(this->receiver, this->callback); }
+        MemberCallback result;
+        std::memset(result.bytes, 0, MAX_SIZE);
+        std::memcpy(result.bytes, &callback, sizeof(Callback));
+        return result;
+    }
 
-    virtual inline void invoke(const IEvent* const e) override
+    template <typename Callback>
+    inline Callback Get() const
     {
-        (receiver->*callback)(reinterpret_cast<const EventType* const>(e));
+        Callback callback;
+        std::memcpy(&callback, this->bytes, sizeof(Callback));
+        return callback;
     }
 
-    virtual inline EventDelegateId GetDelegateId() const override
+    inline bool operator==(const MemberCallback& other) const
     {
-        static const EventDelegateId DELEGATE_ID{ typeid(Class).hash_code() ^ typeid(Callback).hash_code() };
-        return DELEGATE_ID;
+        return std::memcmp(this->bytes, other.bytes, MAX_SIZE) == 0;
     }
+};
+
+// Summary:	Type erased event callback stored by value. The stub casts receiver and events back to their types and
+//			invokes the member function, single event callbacks are invoked once per event in the range.
+struct EventDelegate
+{
+    using Stub = void (*)(void* receiver, const MemberCallback& callback, const void* events, std::size_t count);
+
+    void*          receiver;
+    Stub           stub;
+    MemberCallback callback;
+    bool           batch;
 
-    virtual inline u64 GetStaticEventTypeId() const override
+    inline bool operator==(const EventDelegate& other) const
     {
-        static const u64 SEID{ EventType::STATIC_EVENT_TYPE_ID };
-        return SEID;
+        return this->receiver == other.receiver && this->stub == other.stub && this->callback == other.callback;
     }
+};
 
-    virtual bool operator==(const IEventDelegate* other) const override
+template <typename Class, typename EventType>
+void InvokeEventCallback(void* receiver, const MemberCallback& callback, const void* events, std::size_t count)
+{
+    using Callback = void (Class::*)(const EventType* const);
+
+    const Callback   function = callback.Get<Callback>();
+    Class* const     target   = static_cast<Class*>(receiver);
+    const EventType* first    = static_cast<const EventType*>(events);
+
+    for (std::size_t i = 0; i < count; ++i)
     {
-        if (this->GetDelegateId() != other->GetDelegateId())
-        {
-            return false;
-        }
-
-        EventDelegate* delegate = (EventDelegate*)other;
-        if (other == nullptr)
-        {
-            return false;
-        }
-
-        return ((this->callback == delegate->callback) && (this->receiver == delegate->receiver));
+        (target->*function)(first + i);
     }
+}
+
+template <typename Class, typename EventType>
+void InvokeEventBatchCallback(void* receiver, const MemberCallback& callback, const void* events, std::size_t count)
+{
+    using Callback = void (Class::*)(util::Span<const EventType>);
 
-private:
-    inline void        SetReceiver(Class* receiver) { this->receiver = receiver; }
-    inline auto&       GetReceiver() { return this->receiver; }
-    inline const auto& GetReceiver() const { return this->receiver; }
+    const Callback function = callback.Get<Callback>();
+    (static_cast<Class*>(receiver)->*function)(
+        util::Span<const EventType>(static_cast<const EventType*>(events), count));
+}
 
-    inline void        SetCallback(const Callback& callback) { this->callback = callback; }
-    inline auto&       GetCallback() { return this->callback; }
-    inline const auto& GetCallback() const { return this->callback; }
+template <typename Class, typename EventType>
+inline EventDelegate MakeEventDelegate(Class* receiver, void (Class::*callback)(const EventType* const))
+{
+    return EventDelegate{
+        receiver, &InvokeEventCallback<Class, EventType>, MemberCallback::Make(callback), false
+    };
+}
 
-private:
-    Class*   receiver;
-    Callback callback;
-};
+template <typename Class, typename EventType>
+inline EventDelegate MakeEventDelegate(Class* receiver, void (Class::*callback)(util::Span<const EventType>))
+{
+    return EventDelegate{
+        receiver, &InvokeEventBatchCallback<Class, EventType>, MemberCallback::Make(callback), true
+    };
+}
 
 } // namespace internal
 } // namespace event
@@ -1,11 +1,16 @@
 #pragma once
 
-#include <list>
+#include <initializer_list>
+#include <limits>
+#include <unordered_map>
+#include <vector>
 
 #include "api.h"
 
+#include "event/event_traits.h"
 #include "event/ievent_dispatcher.h"
 #include "log/logger_macro.h"
+#include "memory/memory_resource.h"
 
 namespace ecs
 {
@@ -19,116 +24,254 @@ class ECS_API EventDispatcher : public IEventDispatcher
 {
     DECLARE_STATIC_LOGGER
 
-    using EventDelegateList      = std::list<IEventDelegate*>;
-    using PendingRemoveDelegates = std::list<IEventDelegate*>;
+    // A registered delegate and the slot its token refers to. Removed delegates
+    // stay in place with a null stub until the list is compacted.
+    struct EventCallback
+    {
+        EventDelegate delegate;
+        u32           slot;
+    };
+
+    enum class EventCallbackKind : u8
+    {
+        Event,
+        Batch,
+        Scoped
+    };
+
+    // Maps a token slot to the position of its delegate. Free slots are chained
+    // through index, the version is bumped on release to reject stale tokens.
+    struct EventCallbackSlot
+    {
+        u32               index;
+        u32               version;
+        EventCallbackKind kind;
+        EventScopeId      scope;
+    };
+
+    using EventCallbacks       = memory::internal::Vector<EventCallback>;
+    using EventCallbackSlots   = memory::internal::Vector<EventCallbackSlot>;
+    using ScopedEventCallbacks = memory::internal::UnorderedMap<EventScopeId, EventCallbacks>;
+
+    static constexpr u32 MAX_DISPATCH_DEPTH = 64;
+    static constexpr u32 INVALID_SLOT       = std::numeric_limits<u32>::max();
 
 public:
     EventDispatcher()
-        : locked(false)
-    {
-    }
-    virtual ~EventDispatcher()
+        : freeSlot(INVALID_SLOT)
+        , numCallbacks(0)
+        , numRemovedCallbacks(0)
+        , lockDepth(0)
     {
-        this->GetPendingRemoveDelegates().clear();
-        this->GetEventCallbacks().clear();
     }
+    virtual ~EventDispatcher() {}
 
-    virtual void Dispatch(IEvent* event) override
+    virtual void Dispatch(IEvent* event) override { this->Dispatch(static_cast<const T*>(event), 1); }
+
+    // Delivers a contiguous range of events to all registered callbacks. Each
+    // event is passed to the callbacks of its type, then to the callbacks of its
+    // scope. Batch callbacks receive the whole range after that.
+    //
+    // A callback may dispatch again (immediate events), also to this dispatcher.
+    // While any dispatch of this type is running removed callbacks are only
+    // tombstoned, they are not invoked anymore and the lists are compacted when
+    // the outermost dispatch returns. Callbacks added meanwhile are appended and
+    // already see the remaining events.
+    void Dispatch(const T* events, std::size_t count)
     {
-        this->SetLocked(true);
-        LogTrace("Dispatch event %s", typeid(T).name());
-        if (this->GetPendingRemoveDelegates().empty() == false)
+        assert(this->lockDepth < MAX_DISPATCH_DEPTH && "Event dispatch recursion too deep.");
+        ++this->lockDepth;
+        LogTrace("Dispatch %zu events %s", count, typeid(T).name());
+
+        if (this->eventCallbacks.empty() == false)
         {
-            for (auto EC : this->GetPendingRemoveDelegates())
+            for (std::size_t i = 0; i < count; ++i)
             {
-                auto result = std::find_if(this->GetEventCallbacks().begin(),
-                                           this->GetEventCallbacks().end(),
-                                           [&](const IEventDelegate* other) { return other->operator==(EC); });
-                if (result != this->GetEventCallbacks().end())
+                // copy, a callback may append to the list and move its storage
+                for (std::size_t d = 0; d < this->eventCallbacks.size(); ++d)
                 {
-                    IEventDelegate* ptrMem = (IEventDelegate*)(*result);
-                    this->GetEventCallbacks().erase(result);
-                    delete ptrMem;
-                    ptrMem = nullptr;
+                    const EventDelegate EC = this->eventCallbacks[d].delegate;
+                    if (EC.stub != nullptr)
+                    {
+                        EC.stub(EC.receiver, EC.callback, events + i, 1);
+                    }
                 }
             }
-            this->GetPendingRemoveDelegates().clear();
         }
 
-        for (auto EC : this->GetEventCallbacks())
+        if constexpr (EventScope<T>::value)
+        {
+            if (this->scopedEventCallbacks.empty() == false)
+            {
+                this->DispatchScoped(events, count);
+            }
+        }
+
+        for (std::size_t d = 0; d < this->eventBatchCallbacks.size(); ++d)
+        {
+            const EventDelegate EC = this->eventBatchCallbacks[d].delegate;
+            if (EC.stub != nullptr)
+            {
+                EC.stub(EC.receiver, EC.callback, events, count);
+            }
+        }
+
+        if (--this->lockDepth == 0 && this->numRemovedCallbacks > 0)
         {
-            assert(EC != nullptr && "Invalid event callback.");
-            EC->invoke(event);
+            this->CompactEventCallbacks();
         }
+    }
 
-        this->SetLocked(false);
+    virtual EventCallbackToken AddEventCallback(const EventDelegate& eventDelegate) override
+    {
+        const EventCallbackKind kind = eventDelegate.batch ? EventCallbackKind::Batch : EventCallbackKind::Event;
+        return this->AddEventCallback(eventDelegate, kind, 0);
     }
-    virtual void AddEventCallback(IEventDelegate* eventDelegate) override
+
+    virtual EventCallbackToken AddScopedEventCallback(const EventDelegate& eventDelegate, EventScopeId scope) override
     {
-        auto result = std::find_if(this->GetPendingRemoveDelegates().begin(),
-                                   this->GetPendingRemoveDelegates().end(),
-                                   [&](const IEventDelegate* other) { return other->operator==(eventDelegate); });
+        assert(eventDelegate.batch == false && "Batch callbacks cannot be scoped.");
+        return this->AddEventCallback(eventDelegate, EventCallbackKind::Scoped, scope);
+    }
 
-        if (result != this->GetPendingRemoveDelegates().end())
+    virtual void RemoveEventCallback(const EventCallbackToken& token) override
+    {
+        if (token.slot >= this->eventCallbackSlots.size() ||
+            this->eventCallbackSlots[token.slot].version != token.version)
         {
-            this->GetPendingRemoveDelegates().erase(result);
             return;
         }
 
-        this->GetEventCallbacks().push_back(eventDelegate);
+        EventCallbackSlot& callbackSlot = this->eventCallbackSlots[token.slot];
+        EventCallbacks&    callbacks    = this->GetEventCallbackList(callbackSlot.kind, callbackSlot.scope);
+
+        callbacks[callbackSlot.index].delegate.stub = nullptr;
+        --this->numCallbacks;
+        ++this->numRemovedCallbacks;
+
+        // release the slot right away, the tombstone does not refer to it anymore
+        ++callbackSlot.version;
+        callbackSlot.index = this->freeSlot;
+        this->freeSlot     = token.slot;
+
+        // amortize the compaction over the removals, dispatch compacts the rest
+        if (this->lockDepth == 0 && this->numRemovedCallbacks >= this->numCallbacks)
+        {
+            this->CompactEventCallbacks();
+        }
     }
-    virtual void RemoveEventCallback(IEventDelegate* eventDelegate) override
+
+    virtual std::size_t GetEventCallbackCount() const override { return this->numCallbacks; }
+
+private:
+    EventCallbackToken AddEventCallback(const EventDelegate& eventDelegate, EventCallbackKind kind, EventScopeId scope)
     {
-        if (this->GetLocked() == false)
+        assert(eventDelegate.stub != nullptr && "Invalid event callback.");
+
+        u32 slot = this->freeSlot;
+        if (slot != INVALID_SLOT)
         {
-            auto result = std::find_if(this->GetEventCallbacks().begin(),
-                                       this->GetEventCallbacks().end(),
-                                       [&](const IEventDelegate* other) { return other->operator==(eventDelegate); });
+            this->freeSlot = this->eventCallbackSlots[slot].index;
+        }
+        else
+        {
+            slot = static_cast<u32>(this->eventCallbackSlots.size());
+            this->eventCallbackSlots.push_back(EventCallbackSlot{ INVALID_SLOT, 0, EventCallbackKind::Event, 0 });
+        }
 
-            if (result != this->GetEventCallbacks().end())
-            {
-                IEventDelegate* ptrMem = (IEventDelegate*)(*result);
+        EventCallbacks& callbacks = this->GetEventCallbackList(kind, scope);
 
-                this->GetEventCallbacks().erase(result);
+        EventCallbackSlot& callbackSlot = this->eventCallbackSlots[slot];
+        callbackSlot.index              = static_cast<u32>(callbacks.size());
+        callbackSlot.kind               = kind;
+        callbackSlot.scope              = scope;
 
-                delete ptrMem;
-                ptrMem = nullptr;
-            }
+        callbacks.push_back(EventCallback{ eventDelegate, slot });
+        ++this->numCallbacks;
+
+        return EventCallbackToken{ T::STATIC_EVENT_TYPE_ID, slot, callbackSlot.version };
+    }
+
+    // Drops tombstones while preserving registration order and re-points the slots of moved callbacks.
+    void CompactEventCallbacks()
+    {
+        assert(this->lockDepth == 0 && "Event callbacks compacted during dispatch.");
+
+        this->CompactEventCallbacks(this->eventCallbacks);
+        this->CompactEventCallbacks(this->eventBatchCallbacks);
+
+        for (auto it = this->scopedEventCallbacks.begin(); it != this->scopedEventCallbacks.end();)
+        {
+            this->CompactEventCallbacks(it->second);
+            it = it->second.empty() ? this->scopedEventCallbacks.erase(it) : std::next(it);
         }
-        else
+
+        this->numRemovedCallbacks = 0;
+    }
+
+    void CompactEventCallbacks(EventCallbacks& callbacks)
+    {
+        std::size_t last = 0;
+        for (std::size_t i = 0; i < callbacks.size(); ++i)
         {
-            auto result = std::find_if(this->GetEventCallbacks().begin(),
-                                       this->GetEventCallbacks().end(),
-                                       [&](const IEventDelegate* other) { return other->operator==(eventDelegate); });
-            //        assert(result != this->GetEventCallbacks().end() && "");
-            if (result != this->GetEventCallbacks().end())
+            if (callbacks[i].delegate.stub != nullptr)
             {
-                this->GetPendingRemoveDelegates().push_back((*result));
+                callbacks[last]                                      = callbacks[i];
+                this->eventCallbackSlots[callbacks[last].slot].index = static_cast<u32>(last);
+                ++last;
             }
         }
+        callbacks.resize(last);
     }
-    virtual std::size_t GetEventCallbackCount() const override { return this->GetEventCallbacks().size(); }
 
-private:
-    inline void SetPendingRemoveDelegates(const PendingRemoveDelegates& pendingRemoveDelegates)
+    // Passes each event to the callbacks registered for its scope only.
+    void DispatchScoped(const T* events, std::size_t count)
     {
-        this->pendingRemoveDelegates = pendingRemoveDelegates;
-    }
-    inline auto&       GetPendingRemoveDelegates() { return this->pendingRemoveDelegates; }
-    inline const auto& GetPendingRemoveDelegates() const { return this->pendingRemoveDelegates; }
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            auto result = this->scopedEventCallbacks.find(EventScope<T>::Get(events + i));
+            if (result == this->scopedEventCallbacks.end())
+            {
+                continue;
+            }
 
-    inline void  SetEventCallbacks(const EventDelegateList& eventCallbacks) { this->eventCallbacks = eventCallbacks; }
-    inline auto& GetEventCallbacks() { return this->eventCallbacks; }
-    inline const auto& GetEventCallbacks() const { return this->eventCallbacks; }
+            // references to map elements survive rehashing, entries are only erased by compaction
+            EventCallbacks& callbacks = result->second;
+            for (std::size_t d = 0; d < callbacks.size(); ++d)
+            {
+                const EventDelegate EC = callbacks[d].delegate;
+                if (EC.stub != nullptr)
+                {
+                    EC.stub(EC.receiver, EC.callback, events + i, 1);
+                }
+            }
+        }
+    }
 
-    inline void        SetLocked(bool locked) { this->locked = locked; }
-    inline auto&       GetLocked() { return this->locked; }
-    inline const auto& GetLocked() const { return this->locked; }
+    inline EventCallbacks& GetEventCallbackList(EventCallbackKind kind, EventScopeId scope)
+    {
+        switch (kind)
+        {
+            case EventCallbackKind::Batch:
+                return this->eventBatchCallbacks;
+            case EventCallbackKind::Scoped:
+                return this->scopedEventCallbacks[scope];
+            default:
+                return this->eventCallbacks;
+        }
+    }
 
 private:
-    PendingRemoveDelegates pendingRemoveDelegates;
-    EventDelegateList      eventCallbacks;
-    bool                   locked;
+    EventCallbacks       eventCallbacks;
+    EventCallbacks       eventBatchCallbacks;
+    ScopedEventCallbacks scopedEventCallbacks;
+    EventCallbackSlots   eventCallbackSlots;
+    u32                  freeSlot;
+    std::size_t          numCallbacks;
+    // tombstones in all lists, reset by compaction
+    std::size_t          numRemovedCallbacks;
+    // number of dispatches of this event type currently on the stack
+    u32                  lockDepth;
 };
 
 DEFINE_STATIC_LOGGER_TEMPLATE(EventDispatcher, T, "EventDispatcher")
@@ -1,61 +1,562 @@
 #include "event/event_handler.h"
 
+namespace
+{
+std::atomic<ecs::u64> eventHandlerInstanceCounter{ 0 };
+
+thread_local ecs::event::internal::ConcurrentEventBuffer* dispatchJobEventBuffer = nullptr;
+
+struct LiveEventHandler
+{
+    ecs::u64                  instanceId;
+    ecs::event::EventHandler* eventHandler;
+};
+
+// Event handlers that exiting threads can hand their buffers back to. Function local, threads may exit while
+// static objects are destroyed.
+std::mutex& GetLiveEventHandlersMutex()
+{
+    static std::mutex* mutex = new std::mutex();
+    return *mutex;
+}
+
+using LiveEventHandlers = ecs::memory::internal::Vector<LiveEventHandler>;
+
+LiveEventHandlers& GetLiveEventHandlers()
+{
+    static LiveEventHandlers* liveEventHandlers = new LiveEventHandlers();
+    return *liveEventHandlers;
+}
+
+ecs::event::EventHandler* FindLiveEventHandler(ecs::u64 instanceId)
+{
+    for (const LiveEventHandler& live : GetLiveEventHandlers())
+    {
+        if (live.instanceId == instanceId)
+        {
+            return live.eventHandler;
+        }
+    }
+
+    return nullptr;
+}
+} // namespace
+
+namespace ecs::event::internal
+{
+
+// Summary:	The event buffers of a thread, one per event handler it sent
+// concurrent events to. They are handed back to their handlers when the
+// thread exits.
+struct ThreadEventBuffers
+{
+    struct Entry
+    {
+        u64                    instanceId;
+        ConcurrentEventBuffer* buffer;
+    };
+
+    ~ThreadEventBuffers()
+    {
+        std::lock_guard<std::mutex> lock(GetLiveEventHandlersMutex());
+
+        for (const Entry& entry : this->entries)
+        {
+            EventHandler* eventHandler = FindLiveEventHandler(entry.instanceId);
+            if (eventHandler != nullptr)
+            {
+                eventHandler->ReleaseThreadEventBuffer(entry.buffer);
+            }
+        }
+    }
+
+    ConcurrentEventBuffer* Find(u64 instanceId) const
+    {
+        for (const Entry& entry : this->entries)
+        {
+            if (entry.instanceId == instanceId)
+            {
+                return entry.buffer;
+            }
+        }
+
+        return nullptr;
+    }
+
+    void Add(u64 instanceId, ConcurrentEventBuffer* buffer)
+    {
+        // drop the buffers of destroyed handlers, they were deleted with them
+        {
+            std::lock_guard<std::mutex> lock(GetLiveEventHandlersMutex());
+
+            this->entries.erase(std::remove_if(this->entries.begin(),
+                                               this->entries.end(),
+                                               [](const Entry& entry)
+                                               { return FindLiveEventHandler(entry.instanceId) == nullptr; }),
+                                this->entries.end());
+        }
+
+        this->entries.push_back(Entry{ instanceId, buffer });
+    }
+
+    memory::internal::Vector<Entry> entries;
+};
+
+} // namespace ecs::event::internal
+
+namespace
+{
+thread_local ecs::event::internal::ThreadEventBuffers threadEventBuffers;
+} // namespace
+
 ecs::event::EventHandler::EventHandler()
+    : overflowPolicy(EventOverflowPolicy::Grow)
+    , memoryStats()
+    , dispatching(false)
+    , eventPayloadPending(false)
+    , instanceId(++eventHandlerInstanceCounter)
+    , concurrentEventsPending(false)
+    , mergeOrder(EventMergeOrder::Unordered)
+    , nextProducerKey(0)
+    , delayedEventTime(0.0)
+    , eventJournal(nullptr)
+    , tick(0)
+    , threadPool(nullptr)
+    , parallelDispatching(false)
 {
     DEFINE_LOGGER("EventHandler")
     LogInfo("Initialize EventHandler!");
 
-    this->eventMemoryAllocator =
-        new EventMemoryAllocator(ECS_EVENT_MEMORY_BUFFER_SIZE, Allocate(ECS_EVENT_MEMORY_BUFFER_SIZE, "EventHandler"));
+    this->writeEventArena = new EventArena(ECS_EVENT_MEMORY_BUFFER_SIZE);
+    this->readEventArena  = new EventArena(ECS_EVENT_MEMORY_BUFFER_SIZE);
+
+    this->GetPendingEventQueues().reserve(64);
+    this->dispatchingEventQueues.reserve(64);
 
-    this->GetEventStorage().reserve(1024);
+    std::lock_guard<std::mutex> lock(GetLiveEventHandlersMutex());
+    GetLiveEventHandlers().push_back(LiveEventHandler{ this->instanceId, this });
 }
 
 ecs::event::EventHandler::~EventHandler()
 {
-    for (EventHandler::EventDispatcherMap::iterator it = this->GetEventDispatcherMap().begin();
-         it != this->GetEventDispatcherMap().end();
-         ++it)
     {
-        delete (*it).second;
-        (*it).second = nullptr;
+        // exiting threads must not hand back buffers from here on
+        std::lock_guard<std::mutex> lock(GetLiveEventHandlersMutex());
+
+        LiveEventHandlers& liveEventHandlers = GetLiveEventHandlers();
+        liveEventHandlers.erase(std::remove_if(liveEventHandlers.begin(),
+                                               liveEventHandlers.end(),
+                                               [this](const LiveEventHandler& live)
+                                               { return live.instanceId == this->instanceId; }),
+                                liveEventHandlers.end());
+    }
+
+    this->ClearEventDispatcher();
+
+    this->delayedEvents.Clear([](internal::IDelayedEvent* delayedEvent) { delete delayedEvent; });
+
+    for (auto& queue : this->GetEventQueues())
+    {
+        delete queue;
+        queue = nullptr;
     }
 
-    this->GetEventDispatcherMap().clear();
+    this->GetEventQueues().clear();
+
+    for (auto buffer : this->concurrentEventBuffers)
+    {
+        delete buffer;
+    }
+
+    this->concurrentEventBuffers.clear();
+    this->releasedEventBuffers.clear();
+
+    for (auto buffer : this->mergeEventBuffers)
+    {
+        delete buffer;
+    }
+
+    this->mergeEventBuffers.clear();
+
+    for (auto buffer : this->dispatchJobBuffers)
+    {
+        delete buffer;
+    }
+
+    this->dispatchJobBuffers.clear();
 
     // Release allocated memory
-    this->Free((void*)this->GetEventMemoryAllocator()->GetMemoryAddress());
+    delete this->writeEventArena;
+    this->writeEventArena = nullptr;
 
-    delete this->GetEventMemoryAllocator();
-    this->SetEventMemoryAllocator(nullptr);
+    delete this->readEventArena;
+    this->readEventArena = nullptr;
 
     LogInfo("Relealse EventHandler!");
 }
 
+void ecs::event::EventHandler::ClearEventBuffer()
+{
+    this->UpdateMemoryStats();
+
+    for (auto queue : this->GetEventQueues())
+    {
+        if (queue != nullptr)
+        {
+            queue->Clear();
+            queue->SetScheduled(false);
+        }
+    }
+
+    this->GetPendingEventQueues().clear();
+    this->GetWriteEventArena()->Clear();
+    this->GetReadEventArena()->Clear();
+}
+
+void ecs::event::EventHandler::ClearEventDispatcher()
+{
+    for (auto& dispatcher : this->GetEventDispatchers())
+    {
+        delete dispatcher;
+        dispatcher = nullptr;
+    }
+
+    this->GetEventDispatchers().clear();
+}
+
+ecs::event::internal::ConcurrentEventBuffer* ecs::event::EventHandler::GetThreadEventBuffer()
+{
+    internal::ConcurrentEventBuffer* buffer = threadEventBuffers.Find(this->instanceId);
+    if (buffer != nullptr)
+    {
+        return buffer;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->concurrentEventBuffersMutex);
+
+        // buffers of exited threads are reused once their events are merged
+        for (std::size_t i = 0; i < this->releasedEventBuffers.size(); ++i)
+        {
+            if (this->releasedEventBuffers[i]->GetEventCount() == 0)
+            {
+                buffer = this->releasedEventBuffers[i];
+                buffer->SetProducerKey(this->nextProducerKey++);
+
+                this->releasedEventBuffers[i] = this->releasedEventBuffers.back();
+                this->releasedEventBuffers.pop_back();
+                break;
+            }
+        }
+
+        if (buffer == nullptr)
+        {
+            buffer = new internal::ConcurrentEventBuffer(this->nextProducerKey++);
+            this->concurrentEventBuffers.push_back(buffer);
+        }
+    }
+
+    threadEventBuffers.Add(this->instanceId, buffer);
+    return buffer;
+}
+
+void ecs::event::EventHandler::ReleaseThreadEventBuffer(internal::ConcurrentEventBuffer* buffer)
+{
+    std::lock_guard<std::mutex> lock(this->concurrentEventBuffersMutex);
+    this->releasedEventBuffers.push_back(buffer);
+}
+
+bool ecs::event::EventHandler::CancelDelayed(DelayedEventHandle handle)
+{
+    internal::IDelayedEvent* delayedEvent = nullptr;
+    if (this->delayedEvents.Cancel(handle, delayedEvent) == false)
+    {
+        return false;
+    }
+
+    delete delayedEvent;
+    return true;
+}
+
+void ecs::event::EventHandler::AdvanceDelayedEvents(f32 tickMS)
+{
+    this->delayedEventTime += tickMS;
+
+    const f64 ticks = std::floor(this->delayedEventTime / ECS_EVENT_TIMER_RESOLUTION_MS);
+    if (ticks < 1.0)
+    {
+        return;
+    }
+
+    this->delayedEventTime -= ticks * ECS_EVENT_TIMER_RESOLUTION_MS;
+
+    this->delayedEvents.Advance(this->delayedEvents.GetCurrentTick() + static_cast<u64>(ticks),
+                                [this](internal::IDelayedEvent* delayedEvent)
+                                {
+                                    delayedEvent->Send(this);
+                                    delete delayedEvent;
+                                });
+}
+
+void ecs::event::EventHandler::SetThreadProducerKey(u32 producerKey)
+{
+    this->GetThreadEventBuffer()->SetProducerKey(producerKey);
+}
+
+void ecs::event::EventHandler::MergeConcurrentEvents()
+{
+    this->concurrentEventsPending.store(false, std::memory_order_relaxed);
+
+    // Relocating runs listeners that may send concurrent events themselves, so the events are moved out of the
+    // thread buffers first and relocated without holding the mutex.
+    std::size_t numMergeBuffers = 0;
+    {
+        std::lock_guard<std::mutex> lock(this->concurrentEventBuffersMutex);
+
+        if (this->mergeOrder == EventMergeOrder::Stable)
+        {
+            std::stable_sort(this->concurrentEventBuffers.begin(),
+                             this->concurrentEventBuffers.end(),
+                             [](const internal::ConcurrentEventBuffer* lhs, const internal::ConcurrentEventBuffer* rhs)
+                             { return lhs->GetProducerKey() < rhs->GetProducerKey(); });
+        }
+
+        for (auto buffer : this->concurrentEventBuffers)
+        {
+            if (buffer->GetEventCount() == 0)
+            {
+                continue;
+            }
+
+            if (numMergeBuffers == this->mergeEventBuffers.size())
+            {
+                this->mergeEventBuffers.push_back(new internal::ConcurrentEventBuffer(0));
+            }
+
+            // the thread buffer gets the emptied blocks of the last merge back
+            this->mergeEventBuffers[numMergeBuffers++]->SwapEvents(*buffer);
+        }
+    }
+
+    for (std::size_t i = 0; i < numMergeBuffers; ++i)
+    {
+        this->mergeEventBuffers[i]->Relocate(this);
+    }
+}
+
+ecs::event::EventMemoryStats ecs::event::EventHandler::GetMemoryStats() const
+{
+    EventMemoryStats stats = this->memoryStats;
+
+    stats.usedMemory     = this->GetWriteEventArena()->GetUsedMemory() + this->GetReadEventArena()->GetUsedMemory();
+    stats.peakUsedMemory = std::max(stats.peakUsedMemory, stats.usedMemory);
+    stats.reservedMemory =
+        this->GetWriteEventArena()->GetReservedMemory() + this->GetReadEventArena()->GetReservedMemory();
+    stats.numBlocks = this->GetWriteEventArena()->GetBlockCount() + this->GetReadEventArena()->GetBlockCount();
+
+    return stats;
+}
+
+void ecs::event::EventHandler::UpdateMemoryStats()
+{
+    const std::size_t usedMemory =
+        this->GetWriteEventArena()->GetUsedMemory() + this->GetReadEventArena()->GetUsedMemory();
+
+    this->memoryStats.peakUsedMemory = std::max(this->memoryStats.peakUsedMemory, usedMemory);
+}
+
+bool ecs::event::EventHandler::HandleEventOverflow(internal::IEventQueue* queue, std::size_t eventSize)
+{
+    switch (this->overflowPolicy)
+    {
+        case EventOverflowPolicy::Grow:
+            this->GetWriteEventArena()->Grow(eventSize);
+            LogInfo("Event buffer grown to %zu bytes.", this->GetWriteEventArena()->GetReservedMemory());
+            return true;
+
+        case EventOverflowPolicy::Block:
+            if (this->dispatching == true || this->eventPayloadPending == true)
+            {
+                // the pending events are already being delivered, we can't wait for ourselves
+                this->GetWriteEventArena()->Grow(eventSize);
+                return true;
+            }
+
+            ++this->memoryStats.numFlushes;
+            this->DispatchEvents();
+            return true;
+
+        case EventOverflowPolicy::DropOldest:
+        {
+            const std::size_t numDropped = queue->RecycleOldestPage();
+            this->memoryStats.numDroppedEvents += numDropped;
+            return numDropped > 0;
+        }
+    }
+
+    return false;
+}
+
+void* ecs::event::EventHandler::AllocateEventPayload(std::size_t size)
+{
+    const u8 alignment = alignof(std::max_align_t);
+
+    if (this->parallelDispatching == true)
+    {
+        // the queues are left alone during a parallel pass, so growing is the only option
+        std::lock_guard<std::mutex> lock(this->eventPayloadMutex);
+
+        void* payload = this->GetWriteEventArena()->Allocate(size, alignment);
+        if (payload == nullptr)
+        {
+            this->GetWriteEventArena()->Grow(size + alignment);
+            payload = this->GetWriteEventArena()->Allocate(size, alignment);
+        }
+        return payload;
+    }
+
+    void* payload = this->GetWriteEventArena()->Allocate(size, alignment);
+
+    // dropping queued events frees no arena memory, the payload's event is dropped instead
+    if (payload == nullptr && this->overflowPolicy != EventOverflowPolicy::DropOldest &&
+        this->HandleEventOverflow(nullptr, size + alignment) == true)
+    {
+        payload = this->GetWriteEventArena()->Allocate(size, alignment);
+    }
+
+    return payload;
+}
+
 void ecs::event::EventHandler::DispatchEvents()
 {
-    std::size_t lastIndex = this->GetEventStorage().size();
-    std::size_t thisIndex = 0;
+    this->dispatching = true;
+
+    if (this->concurrentEventsPending.load(std::memory_order_acquire) == true)
+    {
+        this->MergeConcurrentEvents();
+    }
 
-    while (thisIndex < lastIndex)
+    // Every pass dispatches the queues that were pending when it started. Events sent
+    // by listeners during a pass schedule their queue again and go into the next one.
+    // They are written to the other arena, so the one being dispatched is never touched.
+    while (this->GetPendingEventQueues().empty() == false)
     {
-        auto event = this->GetEventStorage()[thisIndex++];
-        if (event == nullptr)
+        this->dispatchingEventQueues.swap(this->GetPendingEventQueues());
+        std::swap(this->writeEventArena, this->readEventArena);
+
+        for (EventTypeId typeId : this->dispatchingEventQueues)
         {
-            LogError("Skip corrupted event.", event->GetTypeID());
-            continue;
+            this->GetEventQueues()[typeId]->SetScheduled(false);
+            this->GetEventQueues()[typeId]->Seal();
         }
 
-        auto it = this->GetEventDispatcherMap().find(event->GetTypeID());
-        if (it == this->GetEventDispatcherMap().end())
+        if (this->eventJournal != nullptr)
         {
-            continue;
+            for (EventTypeId typeId : this->dispatchingEventQueues)
+            {
+                this->GetEventQueues()[typeId]->Record(this->eventJournal, this->tick);
+            }
         }
 
-        it->second->Dispatch(event);
+        this->DispatchEventQueues();
+
+        this->dispatchingEventQueues.clear();
 
-        lastIndex = this->GetEventStorage().size();
+        this->UpdateMemoryStats();
+        this->GetReadEventArena()->Clear();
     }
 
     this->ClearEventBuffer();
+    this->dispatching = false;
+}
+
+ecs::event::internal::ConcurrentEventBuffer* ecs::event::EventHandler::GetDispatchJobEventBuffer()
+{
+    assert(dispatchJobEventBuffer != nullptr && "Event sent during parallel dispatch from outside a dispatch job.");
+    return dispatchJobEventBuffer;
+}
+
+void ecs::event::EventHandler::DispatchEventQueues()
+{
+    if (this->threadPool != nullptr && this->dispatchingEventQueues.size() > 1)
+    {
+        this->DispatchEventQueuesParallel();
+        return;
+    }
+
+    for (EventTypeId typeId : this->dispatchingEventQueues)
+    {
+        this->GetEventQueues()[typeId]->Dispatch(this->FindEventDispatcher(typeId));
+    }
+}
+
+void ecs::event::EventHandler::DispatchEventQueuesParallel()
+{
+    // group 0 may touch anything, it runs alone and its listeners send events as usual
+    this->dispatchJobQueues.clear();
+    for (EventTypeId typeId : this->dispatchingEventQueues)
+    {
+        internal::IEventQueue* queue = this->GetEventQueues()[typeId];
+        if (queue->GetDispatchGroup() == 0)
+        {
+            queue->Dispatch(this->FindEventDispatcher(typeId));
+        }
+        else
+        {
+            this->dispatchJobQueues.push_back(DispatchJobQueue{ queue->GetDispatchGroup(), typeId });
+        }
+    }
+
+    if (this->dispatchJobQueues.empty() == true)
+    {
+        return;
+    }
+
+    // queues of a group keep the order of the pass
+    std::stable_sort(this->dispatchJobQueues.begin(),
+                     this->dispatchJobQueues.end(),
+                     [](const DispatchJobQueue& lhs, const DispatchJobQueue& rhs) { return lhs.group < rhs.group; });
+
+    this->dispatchJobs.clear();
+    for (std::size_t i = 0; i < this->dispatchJobQueues.size(); ++i)
+    {
+        if (i == 0 || this->dispatchJobQueues[i].group != this->dispatchJobQueues[i - 1].group)
+        {
+            this->dispatchJobs.push_back(i);
+        }
+    }
+
+    const std::size_t numJobs = this->dispatchJobs.size();
+    this->dispatchJobs.push_back(this->dispatchJobQueues.size());
+
+    while (this->dispatchJobBuffers.size() < numJobs)
+    {
+        this->dispatchJobBuffers.push_back(
+            new internal::ConcurrentEventBuffer(static_cast<u32>(this->dispatchJobBuffers.size())));
+    }
+
+    this->parallelDispatching = true;
+
+    this->threadPool->ParallelFor(numJobs, [this](std::size_t job) { this->DispatchJob(job); });
+
+    this->parallelDispatching = false;
+
+    // events sent by the groups go into the next pass, ordered by group
+    for (std::size_t job = 0; job < numJobs; ++job)
+    {
+        this->dispatchJobBuffers[job]->Relocate(this);
+    }
+}
+
+void ecs::event::EventHandler::DispatchJob(std::size_t job)
+{
+    dispatchJobEventBuffer = this->dispatchJobBuffers[job];
+
+    for (std::size_t i = this->dispatchJobs[job]; i < this->dispatchJobs[job + 1]; ++i)
+    {
+        const EventTypeId typeId = this->dispatchJobQueues[i].typeId;
+        this->GetEventQueues()[typeId]->Dispatch(this->FindEventDispatcher(typeId));
+    }
+
+    dispatchJobEventBuffer = nullptr;
 }
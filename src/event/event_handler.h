@@ -1,78 +1,346 @@
 #pragma once
 
-#include "api.h"
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
 
-#include "memory/allocators/linear_allocator.h"
+#include "api.h"
 
+#include "event/concurrent_event_buffer.h"
+#include "event/delayed_event.h"
+#include "event/event_arena.h"
 #include "event/event_dispatcher.h"
+#include "event/event_journal.h"
+#include "event/event_queue.h"
+#include "event/event_traits.h"
 #include "event/ievent.h"
+#include "memory/memory_resource.h"
+#include "util/thread_pool.h"
+#include "util/timer_wheel.h"
 
 namespace ecs
 {
 namespace event
 {
+namespace internal
+{
+struct ThreadEventBuffers;
+}
+
+// Order in which per-thread event buffers are merged into the event queues.
+enum class EventMergeOrder : u8
+{
+    // buffers are merged in the order they were created, a thread may reuse the buffer of an exited one
+    Unordered,
+    // buffers are merged by ascending producer key, see SetThreadProducerKey; by default in the order the threads
+    // first sent a concurrent event
+    Stable
+};
+
+// What happens to a new event when the event buffer is full.
+enum class EventOverflowPolicy : u8
+{
+    // chain another block of global memory to the event buffer
+    Grow,
+    // deliver all pending events right away to make room; grows instead while events are being dispatched. The
+    // flush runs inside Send, so listeners of every pending event are called from the middle of the sending system's
+    // Update and may see the world in a half updated state.
+    Block,
+    // Events are dropped per type and per page: the oldest not yet dispatched page of events of the same type is
+    // emptied and reused, up to a page's capacity of events is dropped for one new event. The buffer is a bump
+    // arena, so dropping events of other types frees no memory the new event could use. If the type has no such
+    // page, e.g. its only page is sealed for dispatch or the buffer is full of other types' events, the new event
+    // is dropped instead.
+    DropOldest
+};
+
+using DelayedEventHandle = util::TimerHandle;
+
+static const DelayedEventHandle INVALID_DELAYED_EVENT_HANDLE = util::INVALID_TIMER_HANDLE;
+
+struct EventMemoryStats
+{
+    std::size_t usedMemory;
+    std::size_t peakUsedMemory;
+    std::size_t reservedMemory;
+    std::size_t numBlocks;
+    u64         numDroppedEvents;
+    u64         numFlushes;
+    // events merged into a pending event of the same key, see EventCoalescing
+    u64         numCoalescedEvents;
+};
+
 class ECS_API EventHandler : memory::GlobalMemoryUser
 {
     friend class ecs::EcsEngine;
+    friend struct internal::ThreadEventBuffers;
 
     DECLARE_LOGGER
 
-    using EventDispatcherMap = std::unordered_map<EventTypeId, internal::IEventDispatcher*>;
+    // both indexed by the dense event type id
+    using EventDispatchers = memory::internal::Vector<internal::IEventDispatcher*>;
+    using EventQueues      = memory::internal::Vector<internal::IEventQueue*>;
 
-    using EventStorage         = std::vector<IEvent*>;
-    using EventMemoryAllocator = memory::allocator::LinearAllocator;
+    // type ids of queues holding undispatched events, in order of their first event
+    using PendingEventQueues = memory::internal::Vector<EventTypeId>;
+
+    using EventArena = internal::EventArena;
+
+    using ConcurrentEventBuffers = memory::internal::Vector<internal::ConcurrentEventBuffer*>;
+
+    using DelayedEvents = util::TimerWheel<internal::IDelayedEvent*>;
+
+    // a queue of the running pass with its dispatch group, sorted by group for parallel dispatch
+    struct DispatchJobQueue
+    {
+        u32         group;
+        EventTypeId typeId;
+    };
+
+    using DispatchJobQueues = memory::internal::Vector<DispatchJobQueue>;
+    using DispatchJobs      = memory::internal::Vector<std::size_t>;
 
 public:
     EventHandler();
     ~EventHandler();
 
 private:
-    inline void SetEventDispatcherMap(const EventDispatcherMap& eventDispatcherMap)
+    inline void SetEventDispatchers(const EventDispatchers& eventDispatchers)
     {
-        this->eventDispatcherMap = eventDispatcherMap;
+        this->eventDispatchers = eventDispatchers;
     }
-    inline auto&       GetEventDispatcherMap() { return this->eventDispatcherMap; }
-    inline const auto& GetEventDispatcherMap() const { return this->eventDispatcherMap; }
+    inline auto&       GetEventDispatchers() { return this->eventDispatchers; }
+    inline const auto& GetEventDispatchers() const { return this->eventDispatchers; }
+
+    inline void        SetEventQueues(const EventQueues& eventQueues) { this->eventQueues = eventQueues; }
+    inline auto&       GetEventQueues() { return this->eventQueues; }
+    inline const auto& GetEventQueues() const { return this->eventQueues; }
 
-    inline void SetEventMemoryAllocator(EventMemoryAllocator* eventMemoryAllocator)
+    inline void SetPendingEventQueues(const PendingEventQueues& pendingEventQueues)
     {
-        this->eventMemoryAllocator = eventMemoryAllocator;
+        this->pendingEventQueues = pendingEventQueues;
     }
-    inline auto       GetEventMemoryAllocator() { return this->eventMemoryAllocator; }
-    inline const auto GetEventMemoryAllocator() const { return this->eventMemoryAllocator; }
+    inline auto&       GetPendingEventQueues() { return this->pendingEventQueues; }
+    inline const auto& GetPendingEventQueues() const { return this->pendingEventQueues; }
 
-    inline void        SetEventStorage(const EventStorage& eventStorage) { this->eventStorage = eventStorage; }
-    inline auto&       GetEventStorage() { return this->eventStorage; }
-    inline const auto& GetEventStorage() const { return this->eventStorage; }
+    // the write arena takes all new events, the read arena holds the events of the running dispatch pass
+    inline auto       GetWriteEventArena() { return this->writeEventArena; }
+    inline const auto GetWriteEventArena() const { return this->writeEventArena; }
+    inline auto       GetReadEventArena() { return this->readEventArena; }
+    inline const auto GetReadEventArena() const { return this->readEventArena; }
 
 public:
-    inline void ClearEventBuffer()
+    void ClearEventBuffer();
+
+    void ClearEventDispatcher();
+
+    inline bool HasPendingEvents() const
     {
-        this->GetEventMemoryAllocator()->Clear();
-        this->GetEventStorage().clear();
+        return this->GetPendingEventQueues().empty() == false ||
+               this->concurrentEventsPending.load(std::memory_order_acquire) == true;
     }
 
-    inline void ClearEventDispatcher() { this->GetEventDispatcherMap().clear(); }
-
     template <typename E, typename... Args>
     void Send(Args&&... eventArgs)
     {
-        //        static_assert(std::is_trivially_copyable<E>::value,
-        //                      "Event is not trivially copyable.");
+        if constexpr (IsImmediateEvent<E>::value)
+        {
+            this->SendImmediate<E>(std::forward<Args>(eventArgs)...);
+            return;
+        }
+
+        if (this->parallelDispatching == true)
+        {
+            // sent by a listener on the worker pool, merged in group order after the pass
+            GetDispatchJobEventBuffer()->Push<E>(&EventHandler::RelocateEvent<E>, std::forward<Args>(eventArgs)...);
+            return;
+        }
 
-        void* pMem = this->GetEventMemoryAllocator()->Allocate(sizeof(E), alignof(E));
+        auto queue = this->GetEventQueue<E>();
 
-        if (pMem != nullptr)
+        if constexpr (EventCoalescing<E>::value)
         {
-            this->GetEventStorage().push_back(new (pMem) E(std::forward<Args>(eventArgs)...));
-            LogTrace("%s event buffered.", typeid(E).name());
+            // the key is taken from the event, so it is constructed up front
+            E event(std::forward<Args>(eventArgs)...);
+            if (queue->Coalesce(event) == true)
+            {
+                ++this->memoryStats.numCoalescedEvents;
+                LogTrace("%s event coalesced.", typeid(E).name());
+                return;
+            }
+
+            this->Enqueue(queue, std::move(event));
         }
         else
         {
-            LogWarning("Event buffer is full! Cut off new incoming events !!!");
+            this->Enqueue(queue, std::forward<Args>(eventArgs)...);
+        }
+    }
+
+    /**
+     * Buffers an event together with size bytes of data, which are copied into the event buffer so that variable
+     * length events need no allocation of their own. E is constructed from an EventPayload referring to the copy,
+     * followed by eventArgs; the copy is released with the event buffer after the event was dispatched. Must be
+     * called from the thread that dispatches events or from a listener. Immediate events get the data without a copy.
+     * @tparam E - Type of the event.
+     * @param data - The payload data.
+     * @param size - The payload size in bytes.
+     * @param eventArgs - The remaining event constructor arguments.
+     */
+    template <typename E, typename... Args>
+    void SendWithPayload(const void* data, std::size_t size, Args&&... eventArgs)
+    {
+        if constexpr (IsImmediateEvent<E>::value)
+        {
+            this->SendImmediate<E>(EventPayload(data, size), std::forward<Args>(eventArgs)...);
+            return;
         }
+
+        void* payload = nullptr;
+        if (size > 0)
+        {
+            payload = this->AllocateEventPayload(size);
+            if (payload == nullptr)
+            {
+                ++this->memoryStats.numDroppedEvents;
+                LogWarning("Event buffer is full! Cut off new incoming events !!!");
+                return;
+            }
+
+            std::memcpy(payload, data, size);
+        }
+
+        if (this->parallelDispatching == true)
+        {
+            this->Send<E>(EventPayload(payload, size), std::forward<Args>(eventArgs)...);
+            return;
+        }
+
+        // a flush while the event is pushed would release the payload along with the event buffer
+        this->eventPayloadPending = true;
+        this->Send<E>(EventPayload(payload, size), std::forward<Args>(eventArgs)...);
+        this->eventPayloadPending = false;
+    }
+
+    /**
+     * Constructs the event on the stack and delivers it to all listeners before returning, bypassing the event
+     * buffer. Must be called from the thread that dispatches events. It may be called from inside a listener, also
+     * of the same event type; callbacks unregistered meanwhile are released when the outermost dispatch of that
+     * type moves on to its next event.
+     * @tparam E - Type of the event.
+     * @param eventArgs - The event constructor arguments.
+     */
+    template <typename E, typename... Args>
+    void SendImmediate(Args&&... eventArgs)
+    {
+        const EventTypeId ETID = E::STATIC_EVENT_TYPE_ID;
+
+        if (ETID >= this->GetEventDispatchers().size() || this->GetEventDispatchers()[ETID] == nullptr)
+        {
+            return;
+        }
+
+        const E event(std::forward<Args>(eventArgs)...);
+        static_cast<internal::EventDispatcher<E>*>(this->GetEventDispatchers()[ETID])->Dispatch(&event, 1);
     }
 
+    /**
+     * Delivers a range of constructed events to all listeners right away, bypassing the event buffer. The same rules
+     * as for SendImmediate apply.
+     * @tparam E - Type of the event.
+     * @param events - The first event.
+     * @param count - Number of events.
+     */
+    template <typename E>
+    void DispatchImmediate(const E* events, std::size_t count)
+    {
+        const EventTypeId ETID = E::STATIC_EVENT_TYPE_ID;
+
+        if (ETID < this->GetEventDispatchers().size() && this->GetEventDispatchers()[ETID] != nullptr)
+        {
+            static_cast<internal::EventDispatcher<E>*>(this->GetEventDispatchers()[ETID])->Dispatch(events, count);
+        }
+    }
+
+    /**
+     * Buffers an event from any thread. Each thread writes into its own buffer, the buffers are merged into the
+     * event queues by DispatchEvents. Producers on other threads must not send while DispatchEvents merges, i.e.
+     * they have to be joined before the owning thread dispatches. Listeners may send, their events go into the
+     * next DispatchEvents. Once its events are merged, the buffer of an exited thread is reused by the next thread.
+     * @tparam E - Type of the event.
+     * @param eventArgs - The event constructor arguments.
+     */
+    template <typename E, typename... Args>
+    void SendConcurrent(Args&&... eventArgs)
+    {
+        this->GetThreadEventBuffer()->Push<E>(&EventHandler::RelocateEvent<E>, std::forward<Args>(eventArgs)...);
+
+        if (this->concurrentEventsPending.load(std::memory_order_relaxed) == false)
+        {
+            this->concurrentEventsPending.store(true, std::memory_order_release);
+        }
+    }
+
+    /**
+     * Buffers an event after delayMS milliseconds of engine time have passed. The arguments are stored until then,
+     * the event is constructed when it is sent. The delay is rounded up to ECS_EVENT_TIMER_RESOLUTION_MS and a
+     * delayed event is sent at the earliest by the next engine update.
+     * @tparam E - Type of the event.
+     * @param delayMS - The delay in milliseconds.
+     * @param eventArgs - The event constructor arguments.
+     * @return A handle to cancel the event.
+     */
+    template <typename E, typename... Args>
+    DelayedEventHandle SendDelayed(f32 delayMS, Args&&... eventArgs)
+    {
+        using DelayedEvent = internal::DelayedEvent<E, std::decay_t<Args>...>;
+
+        internal::IDelayedEvent* delayedEvent = new DelayedEvent(
+            &EventHandler::SendDelayedEvent<E, std::decay_t<Args>...>, std::forward<Args>(eventArgs)...);
+
+        const f64 ticks = std::ceil(static_cast<f64>(delayMS) / ECS_EVENT_TIMER_RESOLUTION_MS);
+        return this->delayedEvents.Schedule(ticks > 0.0 ? static_cast<u64>(ticks) : 0, delayedEvent);
+    }
+
+    // Cancels a delayed event that was not sent yet. Returns false if it was already sent or cancelled.
+    bool CancelDelayed(DelayedEventHandle handle);
+
+    inline std::size_t GetDelayedEventCount() const { return this->delayedEvents.GetTimerCount(); }
+
+    // Advances the time of delayed events and sends all events that are due.
+    void AdvanceDelayedEvents(f32 tickMS);
+
+    // Sets the merge key of the calling thread's event buffer, used by EventMergeOrder::Stable.
+    void SetThreadProducerKey(u32 producerKey);
+
+    inline void            SetConcurrentMergeOrder(EventMergeOrder mergeOrder) { this->mergeOrder = mergeOrder; }
+    inline EventMergeOrder GetConcurrentMergeOrder() const { return this->mergeOrder; }
+
+    inline void SetOverflowPolicy(EventOverflowPolicy overflowPolicy) { this->overflowPolicy = overflowPolicy; }
+    inline EventOverflowPolicy GetOverflowPolicy() const { return this->overflowPolicy; }
+
+    EventMemoryStats GetMemoryStats() const;
+
+    /**
+     * Dispatches the queues of each EventDispatchGroup as a separate job on threadPool, nullptr dispatches all queues
+     * on the calling thread. Events sent by listeners on the pool are buffered per group and queued for the next
+     * dispatch pass in ascending group order, then in the order they were sent. Immediate events sent on the pool
+     * are delivered on the worker thread. Delayed events, subscribing and unsubscribing other event types are not
+     * allowed from listeners of a group. The pool is not owned.
+     */
+    inline void              SetThreadPool(util::ThreadPool* threadPool) { this->threadPool = threadPool; }
+    inline util::ThreadPool* GetThreadPool() const { return this->threadPool; }
+
+    // Records all dispatched events into eventJournal, nullptr stops recording. The journal is not owned.
+    inline void          SetEventJournal(EventJournal* eventJournal) { this->eventJournal = eventJournal; }
+    inline EventJournal* GetEventJournal() const { return this->eventJournal; }
+
+    // Sets the tick events are recorded with, advanced by the engine every update.
+    inline void SetTick(u64 tick) { this->tick = tick; }
+    inline u64  GetTick() const { return this->tick; }
+
     void DispatchEvents();
 
 private:
@@ -80,43 +348,206 @@ private:
     EventHandler& operator=(const EventHandler&) = delete;
 
 private:
-    // Add event callback
+    internal::ConcurrentEventBuffer* GetThreadEventBuffer();
+
+    // Called when the thread owning buffer exits, its events are still merged.
+    void ReleaseThreadEventBuffer(internal::ConcurrentEventBuffer* buffer);
+
+    // buffer of the dispatch job running on the calling thread
+    static internal::ConcurrentEventBuffer* GetDispatchJobEventBuffer();
+
+    inline internal::IEventDispatcher* FindEventDispatcher(EventTypeId typeId) const
+    {
+        return typeId < this->GetEventDispatchers().size() ? this->GetEventDispatchers()[typeId] : nullptr;
+    }
+
+    void DispatchEventQueues();
+
+    void DispatchEventQueuesParallel();
+
+    // Dispatches the queues of one group, runs on the thread pool.
+    void DispatchJob(std::size_t job);
+
+    void MergeConcurrentEvents();
+
+    // Applies the overflow policy after a queue failed to get memory. Returns true if the push should be retried.
+    bool HandleEventOverflow(internal::IEventQueue* queue, std::size_t eventSize);
+
+    void UpdateMemoryStats();
+
+    // Takes size bytes for an event payload from the write arena, nullptr if the overflow policy gives up.
+    void* AllocateEventPayload(std::size_t size);
+
     template <class E>
-    inline void AddEventCallback(internal::IEventDelegate* const eventDelegate)
+    static void RelocateEvent(EventHandler* eventHandler, void* event)
     {
-        EventTypeId ETID = E::STATIC_EVENT_TYPE_ID;
+        E* pEvent = static_cast<E*>(event);
+        eventHandler->Send<E>(std::move(*pEvent));
+        pEvent->~E();
+    }
 
-        EventDispatcherMap::const_iterator iter = this->GetEventDispatcherMap().find(ETID);
-        if (iter == this->GetEventDispatcherMap().end())
+    template <typename E, typename... Args>
+    void Enqueue(internal::EventQueue<E>* queue, Args&&... eventArgs)
+    {
+        // the event is only constructed once a page is available, the arguments are still untouched on failure
+        E* event = queue->Push(this->GetWriteEventArena(), std::forward<Args>(eventArgs)...);
+        if (event == nullptr && this->HandleEventOverflow(queue, sizeof(E)) == true)
         {
-            std::pair<EventTypeId, internal::IEventDispatcher*> kvp(ETID, new internal::EventDispatcher<E>());
-
-            kvp.second->AddEventCallback(eventDelegate);
+            event = queue->Push(this->GetWriteEventArena(), std::forward<Args>(eventArgs)...);
+        }
 
-            this->GetEventDispatcherMap().insert(kvp);
+        if (event != nullptr)
+        {
+            if (queue->IsScheduled() == false)
+            {
+                queue->SetScheduled(true);
+                this->GetPendingEventQueues().push_back(E::STATIC_EVENT_TYPE_ID);
+            }
+            LogTrace("%s event buffered.", typeid(E).name());
         }
         else
         {
-            this->GetEventDispatcherMap()[ETID]->AddEventCallback(eventDelegate);
+            ++this->memoryStats.numDroppedEvents;
+            LogWarning("Event buffer is full! Cut off new incoming events !!!");
+        }
+    }
+
+    template <class E, typename... Args>
+    static void SendDelayedEvent(EventHandler* eventHandler, internal::IDelayedEvent* delayedEvent)
+    {
+        std::apply([eventHandler](Args&... eventArgs) { eventHandler->Send<E>(std::move(eventArgs)...); },
+                   static_cast<internal::DelayedEvent<E, Args...>*>(delayedEvent)->args);
+    }
+
+    template <class E>
+    inline internal::EventQueue<E>* GetEventQueue()
+    {
+        const EventTypeId ETID = E::STATIC_EVENT_TYPE_ID;
+
+        if (ETID >= this->GetEventQueues().size())
+        {
+            this->GetEventQueues().resize(ETID + 1, nullptr);
+        }
+
+        internal::IEventQueue*& queue = this->GetEventQueues()[ETID];
+        if (queue == nullptr)
+        {
+            queue = new internal::EventQueue<E>();
+        }
+
+        return static_cast<internal::EventQueue<E>*>(queue);
+    }
+
+    template <class E>
+    inline internal::IEventDispatcher* GetEventDispatcher()
+    {
+        const EventTypeId ETID = E::STATIC_EVENT_TYPE_ID;
+
+        if (ETID >= this->GetEventDispatchers().size())
+        {
+            this->GetEventDispatchers().resize(ETID + 1, nullptr);
         }
+
+        internal::IEventDispatcher*& dispatcher = this->GetEventDispatchers()[ETID];
+        if (dispatcher == nullptr)
+        {
+            dispatcher = new internal::EventDispatcher<E>();
+        }
+
+        return dispatcher;
+    }
+
+    // Add event callback
+    template <class E>
+    inline EventCallbackToken AddEventCallback(const internal::EventDelegate& eventDelegate)
+    {
+        return this->GetEventDispatcher<E>()->AddEventCallback(eventDelegate);
+    }
+
+    // Add event callback for events of a single scope
+    template <class E>
+    inline EventCallbackToken AddScopedEventCallback(const internal::EventDelegate& eventDelegate, EventScopeId scope)
+    {
+        static_assert(EventScope<E>::value, "Event type has no EventScope specialization.");
+
+        return this->GetEventDispatcher<E>()->AddScopedEventCallback(eventDelegate, scope);
     }
 
     // Remove event callback
-    inline void RemoveEventCallback(internal::IEventDelegate* eventDelegate)
+    inline void RemoveEventCallback(const EventCallbackToken& token)
     {
-        auto                               typeId = eventDelegate->GetStaticEventTypeId();
-        EventDispatcherMap::const_iterator iter   = this->GetEventDispatcherMap().find(typeId);
-        if (iter != this->GetEventDispatcherMap().end())
+        if (token.typeId < this->GetEventDispatchers().size() && this->GetEventDispatchers()[token.typeId] != nullptr)
         {
-            this->GetEventDispatcherMap()[typeId]->RemoveEventCallback(eventDelegate);
+            this->GetEventDispatchers()[token.typeId]->RemoveEventCallback(token);
         }
     }
 
 private:
-    EventDispatcherMap    eventDispatcherMap;
-    EventMemoryAllocator* eventMemoryAllocator;
-    EventStorage          eventStorage;
+    EventDispatchers      eventDispatchers;
+    EventQueues           eventQueues;
+    PendingEventQueues    pendingEventQueues;
+    PendingEventQueues    dispatchingEventQueues;
+    EventArena*           writeEventArena;
+    EventArena*           readEventArena;
+    EventOverflowPolicy   overflowPolicy;
+    EventMemoryStats      memoryStats;
+    bool                  dispatching;
+    // set while an event that refers to a payload in the write arena is pushed
+    bool                  eventPayloadPending;
+    // payloads sent by listeners on the worker pool share the write arena
+    std::mutex            eventPayloadMutex;
+
+    // identifies this instance in the per-thread buffer cache
+    const u64              instanceId;
+    std::mutex             concurrentEventBuffersMutex;
+    ConcurrentEventBuffers concurrentEventBuffers;
+    // buffers of exited threads, handed out again before new ones are created
+    ConcurrentEventBuffers releasedEventBuffers;
+    // the events are moved here to be relocated without holding the mutex
+    ConcurrentEventBuffers mergeEventBuffers;
+    std::atomic<bool>      concurrentEventsPending;
+    EventMergeOrder        mergeOrder;
+    // default producer key of the next thread buffer handed out, keys are never reused
+    u32                    nextProducerKey;
+
+    DelayedEvents delayedEvents;
+    // engine time not yet covered by a whole timer tick
+    f64           delayedEventTime;
+
+    EventJournal* eventJournal;
+    u64           tick;
+
+    util::ThreadPool*      threadPool;
+    bool                   parallelDispatching;
+    DispatchJobQueues      dispatchJobQueues;
+    // first queue of each job, followed by the end of the last one
+    DispatchJobs           dispatchJobs;
+    ConcurrentEventBuffers dispatchJobBuffers;
 };
+
+template <typename E>
+bool EventJournalReader::ReplayEvents(EventHandler* eventHandler, void* events, u32 eventSize, std::size_t count)
+{
+    // recorded with a different layout of E, the data can't be read as E
+    if (eventSize != sizeof(E))
+    {
+        return false;
+    }
+
+    // dense type ids depend on the order types were first used in the recording process
+    E* pEvents = static_cast<E*>(events);
+    if (pEvents[0].GetTypeID() != E::STATIC_EVENT_TYPE_ID)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            pEvents[i].GetTypeID() = E::STATIC_EVENT_TYPE_ID;
+        }
+    }
+
+    eventHandler->DispatchImmediate(static_cast<const E*>(pEvents), count);
+    return true;
+}
+
 } // namespace event
 
 } // namespace ecs
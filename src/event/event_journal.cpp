@@ -0,0 +1,193 @@
+#include "event/event_journal.h"
+
+#include "event/event_handler.h"
+
+namespace ecs::event
+{
+
+namespace
+{
+inline std::size_t AlignJournalSize(std::size_t size)
+{
+    return (size + 7) & ~(std::size_t)7;
+}
+} // namespace
+
+EventJournal::EventJournal()
+    : size(0)
+    , numRecordedEvents(0)
+    , numSkippedEvents(0)
+{
+}
+
+EventJournal::~EventJournal()
+{
+    this->Close();
+}
+
+bool EventJournal::Open(const char* path, std::size_t initialSize)
+{
+    this->Close();
+
+    if (this->file.Create(path, std::max(initialSize, sizeof(internal::EventJournalHeader))) == false)
+    {
+        return false;
+    }
+
+    this->size              = sizeof(internal::EventJournalHeader);
+    this->numRecordedEvents = 0;
+    this->numSkippedEvents  = 0;
+
+    internal::EventJournalHeader* header = reinterpret_cast<internal::EventJournalHeader*>(this->file.GetData());
+    header->magic                        = internal::EVENT_JOURNAL_MAGIC;
+    header->version                      = internal::EVENT_JOURNAL_VERSION;
+    header->size                         = this->size;
+    return true;
+}
+
+void EventJournal::Close()
+{
+    if (this->file.IsOpen() == false)
+    {
+        return;
+    }
+
+    reinterpret_cast<internal::EventJournalHeader*>(this->file.GetData())->size = this->size;
+    this->file.Close(this->size);
+}
+
+void EventJournal::Append(u64 tick, EventJournalTypeKey typeKey, u32 eventSize, const void* events, u32 count)
+{
+    if (this->file.IsOpen() == false || count == 0)
+    {
+        return;
+    }
+
+    const std::size_t dataSize   = static_cast<std::size_t>(eventSize) * count;
+    const std::size_t recordSize = AlignJournalSize(sizeof(internal::EventJournalRecord) + dataSize);
+
+    if (this->size + recordSize > this->file.GetSize())
+    {
+        std::size_t fileSize = this->file.GetSize();
+        while (this->size + recordSize > fileSize)
+        {
+            fileSize *= 2;
+        }
+
+        if (this->file.Resize(fileSize) == false)
+        {
+            this->numSkippedEvents += count;
+            return;
+        }
+    }
+
+    u8* pRecord = this->file.GetData() + this->size;
+
+    internal::EventJournalRecord record{ tick, typeKey, eventSize, count };
+    std::memcpy(pRecord, &record, sizeof(record));
+    std::memcpy(pRecord + sizeof(record), events, dataSize);
+
+    this->size += recordSize;
+    this->numRecordedEvents += count;
+
+    reinterpret_cast<internal::EventJournalHeader*>(this->file.GetData())->size = this->size;
+}
+
+EventJournalReader::EventJournalReader()
+    : size(0)
+    , position(0)
+    , numReplayedEvents(0)
+    , numSkippedEvents(0)
+{
+}
+
+bool EventJournalReader::Open(const char* path)
+{
+    this->Close();
+
+    if (this->file.Open(path) == false)
+    {
+        return false;
+    }
+
+    const internal::EventJournalHeader* header =
+        reinterpret_cast<const internal::EventJournalHeader*>(this->file.GetData());
+
+    if (this->file.GetSize() < sizeof(internal::EventJournalHeader) || header->magic != internal::EVENT_JOURNAL_MAGIC ||
+        header->version != internal::EVENT_JOURNAL_VERSION)
+    {
+        this->file.Close();
+        return false;
+    }
+
+    // a journal that was not closed may be followed by unused file space
+    this->size     = static_cast<std::size_t>(std::min<uint64_t>(header->size, this->file.GetSize()));
+    this->position = sizeof(internal::EventJournalHeader);
+    return true;
+}
+
+void EventJournalReader::Close()
+{
+    this->file.Close();
+    this->size     = 0;
+    this->position = 0;
+}
+
+bool EventJournalReader::ReplayTick(EventHandler* eventHandler)
+{
+    if (this->position + sizeof(internal::EventJournalRecord) > this->size)
+    {
+        return false;
+    }
+
+    const u64 tick = reinterpret_cast<const internal::EventJournalRecord*>(this->file.GetData() + this->position)->tick;
+    const std::size_t startPosition = this->position;
+
+    while (this->position + sizeof(internal::EventJournalRecord) <= this->size)
+    {
+        u8*                                 pRecord = this->file.GetData() + this->position;
+        const internal::EventJournalRecord* record  = reinterpret_cast<const internal::EventJournalRecord*>(pRecord);
+
+        if (record->tick != tick)
+        {
+            break;
+        }
+
+        const std::size_t dataSize = static_cast<std::size_t>(record->eventSize) * record->count;
+        if (this->position + sizeof(internal::EventJournalRecord) + dataSize > this->size)
+        {
+            // the journal ends in the middle of this record, nothing after it can be read
+            this->position = this->size;
+            return false;
+        }
+
+        u8*  pEvents = pRecord + sizeof(internal::EventJournalRecord);
+        auto result  = this->replayFunctions.find(record->typeKey);
+        if (result != this->replayFunctions.end() &&
+            result->second(eventHandler, pEvents, record->eventSize, record->count) == true)
+        {
+            this->numReplayedEvents += record->count;
+        }
+        else
+        {
+            this->numSkippedEvents += record->count;
+        }
+
+        this->position += AlignJournalSize(sizeof(internal::EventJournalRecord) + dataSize);
+    }
+
+    return this->position != startPosition;
+}
+
+u64 EventJournalReader::Replay(EventHandler* eventHandler)
+{
+    const u64 numReplayed = this->numReplayedEvents;
+
+    while (this->ReplayTick(eventHandler) == true)
+    {
+    }
+
+    return this->numReplayedEvents - numReplayed;
+}
+
+} // namespace ecs::event
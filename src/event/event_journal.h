@@ -0,0 +1,147 @@
+#pragma once
+
+#include <typeinfo>
+
+#include "api.h"
+
+#include "event/ievent.h"
+#include "memory/memory_resource.h"
+#include "util/hash.h"
+#include "util/mapped_file.h"
+
+namespace ecs
+{
+namespace event
+{
+
+class EventHandler;
+
+// Summary:	Identifies an event type in a journal. Unlike the dense event type id it does not depend on the order in
+//			which types are first used, it is stable for a build. The event size is part of the key, a type whose
+//			layout grew or shrank since recording gets a new one.
+using EventJournalTypeKey = util::HashValue;
+
+template <typename E>
+inline EventJournalTypeKey GetEventJournalTypeKey()
+{
+    static const EventJournalTypeKey TYPE_KEY{ util::HashCombine(
+        util::HashBytes(typeid(E).name(), std::strlen(typeid(E).name()), 0), sizeof(E)) };
+    return TYPE_KEY;
+}
+
+namespace internal
+{
+
+static constexpr u32 EVENT_JOURNAL_MAGIC   = 0x4A534345; // "ECSJ"
+static constexpr u32 EVENT_JOURNAL_VERSION = 2;
+
+struct EventJournalHeader
+{
+    u32      magic;
+    u32      version;
+    // bytes in use including this header
+    uint64_t size;
+};
+
+// Precedes count events of one type, the events are stored back to back and padded to 8 bytes.
+struct EventJournalRecord
+{
+    uint64_t            tick;
+    EventJournalTypeKey typeKey;
+    u32                 eventSize;
+    u32                 count;
+};
+
+} // namespace internal
+
+// Summary:	Append-only log of dispatched events in a memory-mapped file. Attached to the EventHandler it copies every
+//			page of trivially copyable events into the file right before the page is dispatched, other event types
+//			are counted but not recorded. The file grows by doubling its mapping.
+class ECS_API EventJournal
+{
+public:
+    EventJournal();
+    ~EventJournal();
+
+    bool Open(const char* path, std::size_t initialSize = 16777216);
+
+    // Flushes the header and truncates the file to the recorded size.
+    void Close();
+
+    inline bool IsOpen() const { return this->file.IsOpen(); }
+
+    void Append(u64 tick, EventJournalTypeKey typeKey, u32 eventSize, const void* events, u32 count);
+
+    inline void Skip(std::size_t count) { this->numSkippedEvents += count; }
+
+    inline std::size_t GetSize() const { return this->size; }
+    inline u64         GetRecordedEventCount() const { return this->numRecordedEvents; }
+    inline u64         GetSkippedEventCount() const { return this->numSkippedEvents; }
+
+private:
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+private:
+    util::MappedFile file;
+    std::size_t      size;
+    u64              numRecordedEvents;
+    u64              numSkippedEvents;
+};
+
+// Summary:	Reads a journal written by EventJournal and delivers the events straight to the listeners of an
+//			EventHandler, tick by tick, without buffering them again. Event types have to be registered, records of
+//			unknown types are skipped. Events that listeners send while replaying are buffered as usual. The file is
+//			mapped copy-on-write, event type ids that differ from the recording process are patched in place.
+class ECS_API EventJournalReader
+{
+    // returns false if the recorded event size doesn't match the type
+    using ReplayFunction = bool (*)(EventHandler*, void*, u32, std::size_t);
+
+    using ReplayFunctions = memory::internal::UnorderedMap<EventJournalTypeKey, ReplayFunction>;
+
+public:
+    EventJournalReader();
+    ~EventJournalReader() = default;
+
+    bool Open(const char* path);
+
+    void Close();
+
+    template <typename E>
+    void RegisterEvent()
+    {
+        static_assert(std::is_trivially_copyable<E>::value, "Only trivially copyable events are journaled.");
+        static_assert(alignof(E) <= 8, "Journaled events are aligned to 8 bytes.");
+
+        this->replayFunctions[GetEventJournalTypeKey<E>()] = &EventJournalReader::ReplayEvents<E>;
+    }
+
+    // Delivers all events of the next recorded tick. Returns false at the end of the journal, also if it ends in a
+    // truncated record, e.g. of a process that crashed while recording. Records whose event size doesn't match the
+    // registered type are skipped and counted.
+    bool ReplayTick(EventHandler* eventHandler);
+
+    // Delivers all remaining events at full speed. Returns the number of delivered events.
+    u64 Replay(EventHandler* eventHandler);
+
+    inline void Rewind() { this->position = sizeof(internal::EventJournalHeader); }
+    inline bool IsOpen() const { return this->file.IsOpen(); }
+    inline u64  GetReplayedEventCount() const { return this->numReplayedEvents; }
+    inline u64  GetSkippedEventCount() const { return this->numSkippedEvents; }
+
+private:
+    template <typename E>
+    static bool ReplayEvents(EventHandler* eventHandler, void* events, u32 eventSize, std::size_t count);
+
+private:
+    util::MappedFile file;
+    std::size_t      size;
+    std::size_t      position;
+    ReplayFunctions  replayFunctions;
+    u64              numReplayedEvents;
+    u64              numSkippedEvents;
+};
+
+} // namespace event
+} // namespace ecs
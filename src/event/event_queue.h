@@ -0,0 +1,243 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "api.h"
+
+#include "event/event_arena.h"
+#include "event/event_dispatcher.h"
+#include "event/event_traits.h"
+#include "event/ievent_queue.h"
+#include "memory/memory_resource.h"
+
+namespace ecs
+{
+namespace event
+{
+namespace internal
+{
+
+// Summary:	Contiguous storage for all buffered events of type E. Events are
+// constructed in pages taken from the event arena, pages grow geometrically
+// so a frame with many events of one type only needs a few of them. Pages
+// are never moved, events stay valid until they are dispatched. Sealed
+// pages are closed for writing, new events always go into later pages.
+// Coalescing event types keep an index of the not yet sealed events by key.
+// Events are destroyed once dispatched, dropped or cleared.
+template <typename E>
+class ECS_API EventQueue : public IEventQueue
+{
+    static constexpr std::size_t INITIAL_PAGE_CAPACITY = 64;
+    static constexpr std::size_t MAX_PAGE_CAPACITY     = 16384;
+
+    struct Page
+    {
+        E*          events;
+        std::size_t count;
+        std::size_t capacity;
+    };
+
+    using Pages = memory::internal::Vector<Page>;
+
+    using CoalescedEvents = memory::internal::UnorderedMap<u64, E*>;
+
+public:
+    EventQueue()
+        : IEventQueue(EventDispatchGroup<E>::value)
+        , sealedPages(0)
+        , eventCount(0)
+    {
+    }
+    virtual ~EventQueue() { this->Clear(); }
+
+    template <typename... Args>
+    E* Push(EventArena* arena, Args&&... eventArgs)
+    {
+        if (this->GetPages().size() == this->sealedPages ||
+            this->GetPages().back().count == this->GetPages().back().capacity)
+        {
+            if (this->AllocatePage(arena) == false)
+            {
+                return nullptr;
+            }
+        }
+
+        Page& page  = this->GetPages().back();
+        E*    event = new (page.events + page.count) E(std::forward<Args>(eventArgs)...);
+        ++page.count;
+        ++this->eventCount;
+
+        if constexpr (EventCoalescing<E>::value)
+        {
+            this->coalescedEvents[EventCoalescing<E>::GetKey(event)] = event;
+        }
+
+        return event;
+    }
+
+    // Merges event into the pending event with the same key. Returns false if there is none, the event has to be
+    // pushed then.
+    bool Coalesce(E& event)
+    {
+        static_assert(EventCoalescing<E>::value, "Event type has no EventCoalescing specialization.");
+
+        auto result = this->coalescedEvents.find(EventCoalescing<E>::GetKey(&event));
+        if (result == this->coalescedEvents.end())
+        {
+            return false;
+        }
+
+        if constexpr (HasEventCombine<E>::value)
+        {
+            EventCoalescing<E>::Combine(result->second, &event);
+        }
+        else
+        {
+            *result->second = std::move(event);
+        }
+
+        return true;
+    }
+
+    virtual void Seal() override
+    {
+        this->sealedPages = this->GetPages().size();
+        this->coalescedEvents.clear();
+    }
+
+    virtual void Dispatch(IEventDispatcher* eventDispatcher) override
+    {
+        auto dispatcher = static_cast<EventDispatcher<E>*>(eventDispatcher);
+
+        // listeners may queue new events while we dispatch, these go into pages behind the sealed ones
+        const std::size_t numPages = this->sealedPages;
+        for (std::size_t i = 0; i < numPages; ++i)
+        {
+            const Page page = this->GetPages()[i];
+
+            if (dispatcher != nullptr && page.count > 0)
+            {
+                dispatcher->Dispatch(page.events, page.count);
+            }
+
+            DestroyEvents(page.events, page.count);
+            this->eventCount -= page.count;
+        }
+
+        this->GetPages().erase(this->GetPages().begin(), this->GetPages().begin() + numPages);
+        this->sealedPages = 0;
+    }
+
+    virtual void Record(EventJournal* eventJournal, u64 tick) const override
+    {
+        for (std::size_t i = 0; i < this->sealedPages; ++i)
+        {
+            const Page& page = this->GetPages()[i];
+
+            if constexpr (std::is_trivially_copyable<E>::value && alignof(E) <= 8)
+            {
+                eventJournal->Append(tick,
+                                     GetEventJournalTypeKey<E>(),
+                                     static_cast<u32>(sizeof(E)),
+                                     page.events,
+                                     static_cast<u32>(page.count));
+            }
+            else
+            {
+                eventJournal->Skip(page.count);
+            }
+        }
+    }
+
+    virtual std::size_t RecycleOldestPage() override
+    {
+        if (this->GetPages().size() == this->sealedPages)
+        {
+            return 0;
+        }
+
+        Page page = this->GetPages()[this->sealedPages];
+        this->GetPages().erase(this->GetPages().begin() + this->sealedPages);
+
+        if constexpr (EventCoalescing<E>::value)
+        {
+            for (std::size_t i = 0; i < page.count; ++i)
+            {
+                auto result = this->coalescedEvents.find(EventCoalescing<E>::GetKey(page.events + i));
+                if (result != this->coalescedEvents.end() && result->second == page.events + i)
+                {
+                    this->coalescedEvents.erase(result);
+                }
+            }
+        }
+
+        DestroyEvents(page.events, page.count);
+
+        const std::size_t dropped = page.count;
+        this->eventCount -= dropped;
+        page.count = 0;
+
+        this->GetPages().push_back(page);
+        return dropped;
+    }
+
+    virtual void Clear() override
+    {
+        for (const Page& page : this->GetPages())
+        {
+            DestroyEvents(page.events, page.count);
+        }
+
+        this->GetPages().clear();
+        this->coalescedEvents.clear();
+        this->sealedPages = 0;
+        this->eventCount  = 0;
+    }
+
+    virtual std::size_t GetEventCount() const override { return this->eventCount; }
+
+private:
+    static inline void DestroyEvents(E* events, std::size_t count)
+    {
+        if constexpr (std::is_trivially_destructible<E>::value == false)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                events[i].~E();
+            }
+        }
+    }
+
+    bool AllocatePage(EventArena* arena)
+    {
+        std::size_t capacity = this->GetPages().size() == this->sealedPages
+                                   ? INITIAL_PAGE_CAPACITY
+                                   : std::min(this->GetPages().back().capacity * 2, MAX_PAGE_CAPACITY);
+
+        // fall back to smaller pages when the buffer is almost full
+        for (; capacity > 0; capacity /= 2)
+        {
+            void* pMem = arena->Allocate(sizeof(E) * capacity, alignof(E));
+            if (pMem != nullptr)
+            {
+                this->GetPages().push_back(Page{ static_cast<E*>(pMem), 0, capacity });
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline auto&       GetPages() { return this->pages; }
+    inline const auto& GetPages() const { return this->pages; }
+
+private:
+    Pages           pages;
+    CoalescedEvents coalescedEvents;
+    std::size_t     sealedPages;
+    std::size_t     eventCount;
+};
+
+} // namespace internal
+} // namespace event
+} // namespace ecs
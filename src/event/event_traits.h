@@ -0,0 +1,80 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+#include "event/ievent.h"
+
+namespace ecs
+{
+namespace event
+{
+
+/**
+ * Specialize for an event type to deliver it synchronously from Send instead of buffering it, e.g.
+ * template <> struct IsImmediateEvent<InputEvent> : std::true_type {};
+ */
+template <typename E>
+struct IsImmediateEvent : std::false_type
+{
+};
+
+/**
+ * Specialize for an event type to route it to callbacks registered for a scope (an entity or a channel) in addition
+ * to the callbacks registered for all events of the type, e.g.
+ * template <> struct EventScope<DamageEvent> : std::true_type
+ * {
+ *     static EventScopeId Get(const DamageEvent* event) { return event->target; }
+ * };
+ */
+template <typename E>
+struct EventScope : std::false_type
+{
+};
+
+/**
+ * Specialize for an event type to coalesce buffered events with equal keys, e.g. to send "TransformDirty(entity)" at
+ * most once per dispatch. A new event is merged into the pending one with the same key, by default it replaces it,
+ * an optional Combine merges both instead. Only events that were not yet handed to a dispatch are merged.
+ * template <> struct EventCoalescing<InventoryChanged> : std::true_type
+ * {
+ *     static u64  GetKey(const InventoryChanged* event) { return event->entity; }
+ *     static void Combine(InventoryChanged* pending, const InventoryChanged* next) { pending->count += next->count; }
+ * };
+ */
+template <typename E>
+struct EventCoalescing : std::false_type
+{
+};
+
+/**
+ * Specialize for an event type to dispatch its queue on the worker pool when parallel dispatch is enabled. Queues of
+ * the same group are dispatched in order by one job, different groups run concurrently, so types whose listeners
+ * touch the same data have to share a group. Group 0, the default, is dispatched on the calling thread before the
+ * groups start, e.g.
+ * template <> struct EventDispatchGroup<AudioEvent> : std::integral_constant<u32, 2> {};
+ */
+template <typename E>
+struct EventDispatchGroup : std::integral_constant<u32, 0>
+{
+};
+
+namespace internal
+{
+
+template <typename E, typename = void>
+struct HasEventCombine : std::false_type
+{
+};
+
+template <typename E>
+struct HasEventCombine<E,
+                       std::void_t<decltype(EventCoalescing<E>::Combine(std::declval<E*>(), std::declval<const E*>()))>>
+    : std::true_type
+{
+};
+
+} // namespace internal
+
+} // namespace event
+} // namespace ecs
@@ -8,14 +8,18 @@ namespace event
 {
 using EventTypeId    = TypeID;
 using EventTimeStamp = TimeStamp;
+// entity id or application defined channel id an event is addressed to
+using EventScopeId   = u64;
 
 static const EventTypeId INVALID_EVENT_TYPE = INVALID_TYPE_ID;
 
+// Events are stored and dispatched by their concrete type, the base is not polymorphic so that events with trivially
+// copyable members are trivially copyable as a whole.
 class ECS_API IEvent
 {
 public:
     IEvent(EventTypeId typeId);
-    virtual ~IEvent() = default;
+    ~IEvent() = default;
 
     inline const auto& GetTypeID() const { return this->typeId; }
     inline auto&       GetTypeID() { return this->typeId; }
@@ -32,5 +36,46 @@ private:
     EventTimeStamp timeCreated;
 };
 
+// Variable length data stored in the event buffer next to the event it was sent with, see
+// EventHandler::SendWithPayload. Valid until the event is destroyed after its dispatch. The user-provided copy keeps
+// events holding a payload from being trivially copyable, so they are never written to an event journal, where the
+// pointer would dangle.
+class ECS_API EventPayload
+{
+public:
+    EventPayload()
+        : data(nullptr)
+        , size(0)
+    {
+    }
+
+    EventPayload(const void* data, std::size_t size)
+        : data(static_cast<const u8*>(data))
+        , size(size)
+    {
+    }
+
+    EventPayload(const EventPayload& other)
+        : data(other.data)
+        , size(other.size)
+    {
+    }
+
+    EventPayload& operator=(const EventPayload& other)
+    {
+        this->data = other.data;
+        this->size = other.size;
+        return *this;
+    }
+
+    inline const u8*   GetData() const { return this->data; }
+    inline std::size_t GetSize() const { return this->size; }
+    inline bool        IsEmpty() const { return this->size == 0; }
+
+private:
+    const u8*   data;
+    std::size_t size;
+};
+
 } // namespace event
 } // namespace ecs
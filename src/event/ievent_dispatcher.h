@@ -1,6 +1,7 @@
 #pragma once
 
-#include "event/ievent_delegate.h"
+#include "event/event_delegate.h"
+#include "memory/small_object.h"
 
 namespace ecs
 {
@@ -12,7 +13,7 @@ class IEvent;
 namespace internal
 {
 
-class ECS_API IEventDispatcher
+class ECS_API IEventDispatcher : public memory::SmallObject
 {
 public:
     IEventDispatcher()          = default;
@@ -20,9 +21,11 @@ public:
 
     virtual void Dispatch(IEvent* evnt) = 0;
 
-    virtual void AddEventCallback(IEventDelegate* const eventDelegate) = 0;
+    virtual EventCallbackToken AddEventCallback(const EventDelegate& eventDelegate) = 0;
 
-    virtual void RemoveEventCallback(IEventDelegate* eventDelegate) = 0;
+    virtual EventCallbackToken AddScopedEventCallback(const EventDelegate& eventDelegate, EventScopeId scope) = 0;
+
+    virtual void RemoveEventCallback(const EventCallbackToken& token) = 0;
 
     virtual std::size_t GetEventCallbackCount() const = 0;
 };
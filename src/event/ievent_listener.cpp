@@ -5,11 +5,46 @@ ecs::event::IEventListener::~IEventListener()
     this->UnregisterAllEventCallbacks();
 }
 
+void ecs::event::IEventListener::UnregisterEventCallback(const EventCallbackToken& token)
+{
+    RegisteredCallbacks& callbacks = this->GetRegisteredCallbacks();
+    for (std::size_t i = 0; i < callbacks.size(); ++i)
+    {
+        const EventCallbackToken& other = callbacks[i].token;
+        if (other.typeId == token.typeId && other.slot == token.slot && other.version == token.version)
+        {
+            callbacks[i] = callbacks.back();
+            callbacks.pop_back();
+
+            ecsEngine->UnsubscribeEvent(token);
+            break;
+        }
+    }
+}
+
+void ecs::event::IEventListener::RemoveEventCallback(const internal::EventDelegate& eventDelegate)
+{
+    RegisteredCallbacks& callbacks = this->GetRegisteredCallbacks();
+    for (std::size_t i = 0; i < callbacks.size(); ++i)
+    {
+        if (callbacks[i].delegate == eventDelegate)
+        {
+            const EventCallbackToken token = callbacks[i].token;
+
+            callbacks[i] = callbacks.back();
+            callbacks.pop_back();
+
+            ecsEngine->UnsubscribeEvent(token);
+            break;
+        }
+    }
+}
+
 void ecs::event::IEventListener::UnregisterAllEventCallbacks()
 {
-    for (auto cb : this->GetRegisteredCallbacks())
+    for (const RegisteredCallback& cb : this->GetRegisteredCallbacks())
     {
-        ecsEngine->UnsubscribeEvent(cb);
+        ecsEngine->UnsubscribeEvent(cb.token);
     }
 
     this->GetRegisteredCallbacks().clear();
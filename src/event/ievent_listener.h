@@ -4,6 +4,7 @@
 #include "engine.h"
 
 #include "event/event_delegate.h"
+#include "memory/memory_resource.h"
 
 namespace ecs
 {
@@ -11,7 +12,14 @@ namespace event
 {
 class ECS_API IEventListener
 {
-    using RegisteredCallbacks = std::list<internal::IEventDelegate*>;
+    // Summary:	Subscription of this listener, the delegate identifies it for removal by member function.
+    struct RegisteredCallback
+    {
+        EventCallbackToken      token;
+        internal::EventDelegate delegate;
+    };
+
+    using RegisteredCallbacks = memory::internal::Vector<RegisteredCallback>;
 
 private:
     inline void SetRegisteredCallbacks(const RegisteredCallbacks& registeredCallbacks)
@@ -25,35 +33,68 @@ public:
     IEventListener() = default;
     virtual ~IEventListener();
 
+    /**
+     * Registers a callback invoked once per event of type E. The returned token unregisters it in constant time.
+     */
     template <typename E, typename C>
-    inline void RegisterEventCallback(void (C::*Callback)(const E* const))
+    inline EventCallbackToken RegisterEventCallback(void (C::*Callback)(const E* const))
     {
-        internal::IEventDelegate* eventDelegate = new internal::EventDelegate<C, E>(static_cast<C*>(this), Callback);
-
-        this->GetRegisteredCallbacks().push_back(eventDelegate);
-        ecsEngine->SubscribeEvent<E>(eventDelegate);
+        return this->AddEventCallback<E>(internal::MakeEventDelegate<C, E>(static_cast<C*>(this), Callback));
     }
 
     template <typename E, typename C>
     inline void UnregisterEventCallback(void (C::*Callback)(const E* const))
     {
-        internal::EventDelegate<C, E> delegate(static_cast<C*>(this), Callback);
+        this->RemoveEventCallback(internal::MakeEventDelegate<C, E>(static_cast<C*>(this), Callback));
+    }
+
+    /**
+     * Registers a callback invoked only for events of type E addressed to scope, e.g. the id of the owning entity or
+     * a channel id. E needs an EventScope specialization. Unregistering by member function removes the first
+     * registration of Callback regardless of its scope.
+     */
+    template <typename E, typename C>
+    inline EventCallbackToken RegisterEventCallback(EventScopeId scope, void (C::*Callback)(const E* const))
+    {
+        const internal::EventDelegate eventDelegate =
+            internal::MakeEventDelegate<C, E>(static_cast<C*>(this), Callback);
+        const EventCallbackToken token = ecsEngine->SubscribeEvent<E>(eventDelegate, scope);
 
-        for (auto cb : this->registeredCallbacks)
-        {
-            if (cb->GetDelegateId() == delegate.GetDelegateId())
-            {
-                this->GetRegisteredCallbacks().remove_if([&](const internal::IEventDelegate* other)
-                                                         { return other->operator==(cb); });
+        this->GetRegisteredCallbacks().push_back(RegisteredCallback{ token, eventDelegate });
+        return token;
+    }
+
+    /**
+     * Registers a callback that receives all buffered events of type E as contiguous ranges instead of one call per
+     * event. It may be called more than once per dispatch, each call covers a range that was not delivered before.
+     */
+    template <typename E, typename C>
+    inline EventCallbackToken RegisterEventCallback(void (C::*Callback)(util::Span<const E>))
+    {
+        return this->AddEventCallback<E>(internal::MakeEventDelegate<C, E>(static_cast<C*>(this), Callback));
+    }
 
-                ecsEngine->UnsubscribeEvent(&delegate);
-                break;
-            }
-        }
+    template <typename E, typename C>
+    inline void UnregisterEventCallback(void (C::*Callback)(util::Span<const E>))
+    {
+        this->RemoveEventCallback(internal::MakeEventDelegate<C, E>(static_cast<C*>(this), Callback));
     }
 
+    void UnregisterEventCallback(const EventCallbackToken& token);
+
     void UnregisterAllEventCallbacks();
 
+private:
+    template <typename E>
+    inline EventCallbackToken AddEventCallback(const internal::EventDelegate& eventDelegate)
+    {
+        const EventCallbackToken token = ecsEngine->SubscribeEvent<E>(eventDelegate);
+        this->GetRegisteredCallbacks().push_back(RegisteredCallback{ token, eventDelegate });
+        return token;
+    }
+
+    void RemoveEventCallback(const internal::EventDelegate& eventDelegate);
+
 private:
     RegisteredCallbacks registeredCallbacks;
 };
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "event/event_journal.h"
+#include "event/ievent_dispatcher.h"
+#include "memory/small_object.h"
+
+namespace ecs
+{
+namespace event
+{
+namespace internal
+{
+
+class ECS_API IEventQueue : public memory::SmallObject
+{
+public:
+    explicit IEventQueue(u32 dispatchGroup)
+        : dispatchGroup(dispatchGroup)
+        , scheduled(false)
+    {
+    }
+    virtual ~IEventQueue() = default;
+
+    // Closes the current page, events queued from now on are not part of the next Dispatch.
+    virtual void Seal() = 0;
+
+    // Dispatches and releases all events queued before the last Seal.
+    virtual void Dispatch(IEventDispatcher* eventDispatcher) = 0;
+
+    // Appends all events queued before the last Seal to the journal.
+    virtual void Record(EventJournal* eventJournal, u64 tick) const = 0;
+
+    // Drops the oldest page of events that is not sealed and reuses it for new events. Returns the number of
+    // dropped events.
+    virtual std::size_t RecycleOldestPage() = 0;
+
+    virtual void Clear() = 0;
+
+    virtual std::size_t GetEventCount() const = 0;
+
+    inline void SetScheduled(bool scheduled) { this->scheduled = scheduled; }
+    inline bool IsScheduled() const { return this->scheduled; }
+
+    inline u32 GetDispatchGroup() const { return this->dispatchGroup; }
+
+private:
+    // see EventDispatchGroup
+    const u32 dispatchGroup;
+
+    // true while the queue is listed for the next dispatch pass
+    bool scheduled;
+};
+
+} // namespace internal
+} // namespace event
+} // namespace ecs
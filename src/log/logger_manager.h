@@ -41,6 +41,10 @@ public:
     LoggerManager(const LoggerManager&) = delete;
     LoggerManager& operator=(LoggerManager&) = delete;
     Logger*        GetLogger(const char* logger = DEFAULT_LOGGER);
+
+    inline void                SetLogLevel(log4cplus::LogLevel level) { this->m_RootLogger.setLogLevel(level); }
+    inline log4cplus::LogLevel GetLogLevel() const { return this->m_RootLogger.getLogLevel(); }
+
     log4cplus::Initializer initializer;
 }; // class LoggerManager
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cassert>
+
 #include "memory/allocators/iallocator.hpp"
+#include "memory/memory_debug.h"
 
 namespace ecs
 {
@@ -9,7 +12,7 @@ namespace memory
 namespace allocator
 {
 
-class ECS_API LinearAllocator : public IAllocator
+class ECS_API LinearAllocator final : public IAllocator
 {
     /*
      *   Allocates memory in a linear way
@@ -29,9 +32,54 @@ public:
     LinearAllocator(const std::size_t memorySize, const void* memory);
     virtual ~LinearAllocator();
 
-    virtual void* Allocate(const std::size_t size, const u8 alignment) override;
-    virtual void  Free(void* memory) override;
-    virtual void  Clear() override;
+    // final and defined here, so that calls on a LinearAllocator are inlined
+    virtual inline void* Allocate(const std::size_t size, const u8 alignment) override
+    {
+        assert(size > 0 && "allocate calles with memSize = 0.");
+
+        union
+        {
+            void* asVoidPointer;
+            uptr  asUptr;
+        };
+
+        asVoidPointer = (void*)this->memoryAddress;
+        asUptr += this->memoryUsed;
+
+        u8 adjustment = GetAdjustment(asVoidPointer, alignment);
+
+        if (this->memoryUsed + size + adjustment > this->memorySize)
+        {
+            return nullptr;
+        }
+
+        asUptr += adjustment;
+
+        ECS_UNPOISON_MEMORY(asVoidPointer, size);
+#if ECS_MEMORY_DEBUG
+        std::memset(asVoidPointer, debug::ALLOCATED_PATTERN, size);
+#endif
+
+        this->memoryUsed += size + adjustment;
+        this->memoryAllocationsCount++;
+
+        return asVoidPointer;
+    }
+
+    virtual void Free(void* memory) override;
+
+    virtual inline void Clear() override
+    {
+#if ECS_MEMORY_DEBUG
+        // everything allocated so far is stale now, alignment gaps in between are still poisoned
+        ECS_UNPOISON_MEMORY(this->memoryAddress, this->memoryUsed);
+        std::memset((void*)this->memoryAddress, debug::FREED_PATTERN, this->memoryUsed);
+        ECS_POISON_MEMORY(this->memoryAddress, this->memorySize);
+#endif
+
+        this->memoryUsed             = 0;
+        this->memoryAllocationsCount = 0;
+    }
 };
 
 } // namespace allocator
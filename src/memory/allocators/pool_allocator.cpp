@@ -16,36 +16,10 @@ ecs::memory::allocator::PoolAllocator::PoolAllocator(const std::size_t memorySiz
 
 ecs::memory::allocator::PoolAllocator::~PoolAllocator()
 {
-    this->freeList = nullptr;
-}
-
-void* ecs::memory::allocator::PoolAllocator::Allocate(const std::size_t size, const u8 alignment)
-{
-    assert(size > 0 && "allocate called with memorySize = 0.");
-    assert(size == this->objectSize && alignment == this->objectAlignment);
-
-    if (this->freeList == nullptr)
-    {
-        return nullptr;
-    }
-
-    void* pointer = this->freeList;
-
-    this->freeList = (void**)(*this->freeList);
+    // the memory goes back to its owner
+    ECS_UNPOISON_MEMORY(this->memoryAddress, this->memorySize);
 
-    this->memoryUsed += this->objectSize;
-    this->memoryAllocationsCount++;
-
-    return pointer;
-}
-
-void ecs::memory::allocator::PoolAllocator::Free(void* memory)
-{
-    *((void**)memory) = this->freeList;
-    this->freeList    = (void**)memory;
-
-    this->memoryUsed -= this->objectSize;
-    this->memoryAllocationsCount--;
+    this->freeList = nullptr;
 }
 
 void ecs::memory::allocator::PoolAllocator::Clear()
@@ -61,6 +35,11 @@ void ecs::memory::allocator::PoolAllocator::Clear()
 
     asVoidPointer = (void*)this->memoryAddress;
 
+    ECS_UNPOISON_MEMORY(asVoidPointer, this->memorySize);
+#if ECS_MEMORY_DEBUG
+    std::memset(asVoidPointer, debug::FREED_PATTERN, this->memorySize);
+#endif
+
     asUptd += adjustment;
 
     this->freeList = (void**)asVoidPointer;
@@ -74,4 +53,6 @@ void ecs::memory::allocator::PoolAllocator::Clear()
     }
 
     *pointer = nullptr;
+
+    ECS_POISON_MEMORY(this->memoryAddress, this->memorySize);
 }
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <cassert>
+
 #include "memory/allocators/iallocator.hpp"
+#include "memory/memory_debug.h"
+#include "memory/small_object.h"
 
 namespace ecs
 {
@@ -9,7 +13,9 @@ namespace memory
 namespace allocator
 {
 
-class ECS_API PoolAllocator : public IAllocator
+// Summary:	Fixed size object pool. The class is final and its hot paths are defined here, so that calls on a
+//			PoolAllocator are dispatched statically and inlined, IAllocator stays the facade for runtime polymorphism.
+class ECS_API PoolAllocator final : public IAllocator, public SmallObject
 {
 public:
     PoolAllocator(const std::size_t memorySize,
@@ -18,9 +24,66 @@ public:
                   const u8          objectAlignment);
     virtual ~PoolAllocator();
 
-    virtual void* Allocate(const std::size_t size, const u8 alignment) override;
-    virtual void  Free(void* memory) override;
-    virtual void  Clear() override;
+    virtual inline void* Allocate(const std::size_t size, const u8 alignment) override
+    {
+        assert(size > 0 && "allocate called with memorySize = 0.");
+        assert(size == this->objectSize && alignment == this->objectAlignment);
+
+        if (this->freeList == nullptr)
+        {
+            return nullptr;
+        }
+
+        void* pointer = this->freeList;
+
+#if ECS_MEMORY_DEBUG
+        ECS_UNPOISON_MEMORY(pointer, this->objectSize);
+        assert(debug::CheckPattern(
+                   (u8*)pointer + sizeof(void*), debug::FREED_PATTERN, this->objectSize - sizeof(void*)) == true &&
+               "Freed pool memory was written to.");
+        assert((*this->freeList == nullptr || ((uptr)*this->freeList >= (uptr)this->memoryAddress &&
+                                               (uptr)*this->freeList < (uptr)this->memoryAddress + this->memorySize)) &&
+               "Free list link of pool memory was overwritten.");
+#endif
+
+        this->freeList = (void**)(*this->freeList);
+
+#if ECS_MEMORY_DEBUG
+        std::memset(pointer, debug::ALLOCATED_PATTERN, this->objectSize);
+#endif
+
+        this->memoryUsed += this->objectSize;
+        this->memoryAllocationsCount++;
+
+        return pointer;
+    }
+
+    virtual inline void Free(void* memory) override
+    {
+#if ECS_MEMORY_DEBUG
+        // a freed slot holds the freed pattern behind the free list link until it is allocated again
+        ECS_UNPOISON_MEMORY(memory, this->objectSize);
+        assert((this->objectSize <= sizeof(void*) ||
+                debug::CheckPattern(
+                    (u8*)memory + sizeof(void*), debug::FREED_PATTERN, this->objectSize - sizeof(void*)) == false) &&
+               "Pool memory freed twice.");
+
+        std::memset(memory, debug::FREED_PATTERN, this->objectSize);
+#endif
+
+        *((void**)memory) = this->freeList;
+        this->freeList    = (void**)memory;
+
+        ECS_POISON_MEMORY(memory, this->objectSize);
+
+        this->memoryUsed -= this->objectSize;
+        this->memoryAllocationsCount--;
+    }
+
+    virtual void Clear() override;
+
+    inline std::size_t GetObjectSize() const { return this->objectSize; }
+    inline u8          GetObjectAlignment() const { return this->objectAlignment; }
 
 private:
     const std::size_t objectSize;
@@ -9,7 +9,7 @@ namespace memory
 namespace allocator
 {
 
-class ECS_API StackAllocator : public IAllocator
+class ECS_API StackAllocator final : public IAllocator
 {
 public:
     StackAllocator(const std::size_t memorySize, const void* memory);
@@ -0,0 +1,372 @@
+#include "memory/allocators/tlsf_allocator.h"
+
+#include <cassert>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+
+inline ecs::u32 FindFirstSet(ecs::u32 word)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, word);
+    return static_cast<ecs::u32>(index);
+#else
+    return static_cast<ecs::u32>(__builtin_ctz(word));
+#endif
+}
+
+inline ecs::u32 FindLastSet(std::size_t word)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanReverse64(&index, word);
+    return static_cast<ecs::u32>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse(&index, word);
+    return static_cast<ecs::u32>(index);
+#else
+    return static_cast<ecs::u32>(sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(word));
+#endif
+}
+
+inline std::size_t AlignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+ecs::memory::allocator::TLSFAllocator::TLSFAllocator(const std::size_t memorySize, const void* memory)
+    : TLSFAllocator(memorySize, memory, memorySize)
+{
+}
+
+ecs::memory::allocator::TLSFAllocator::TLSFAllocator(const std::size_t memorySize,
+                                                     const void*       memory,
+                                                     const std::size_t poolSize)
+    : IAllocator(memorySize, memory)
+    , poolSize(std::min(poolSize, memorySize))
+    , sentinel(nullptr)
+{
+    assert(memorySize < MAX_BLOCK_SIZE && "Memory exceeds the largest block size.");
+    this->Clear();
+}
+
+ecs::memory::allocator::TLSFAllocator::~TLSFAllocator()
+{
+}
+
+void* ecs::memory::allocator::TLSFAllocator::Allocate(const std::size_t size, const u8 alignment)
+{
+    assert(size > 0 && "allocate called with memorySize = 0.");
+    assert((alignment & (alignment - 1)) == 0 && "Alignment must be a power of two.");
+
+    const std::size_t blockSize = std::max(AlignUp(size, ALIGNMENT), MIN_BLOCK_SIZE);
+
+    // payloads are ALIGNMENT aligned, larger alignments need room to split off a leading free block
+    const std::size_t gapSize = alignment > ALIGNMENT ? alignment + HEADER_SIZE + MIN_BLOCK_SIZE : 0;
+
+    if (blockSize + gapSize >= MAX_BLOCK_SIZE)
+    {
+        return nullptr;
+    }
+
+    BlockHeader* block = this->FindFreeBlock(blockSize + gapSize);
+    if (block == nullptr)
+    {
+        return nullptr;
+    }
+
+    if (alignment > ALIGNMENT)
+    {
+        const uptr payload = reinterpret_cast<uptr>(GetPayload(block));
+        if ((payload & (alignment - 1)) != 0)
+        {
+            const uptr aligned = AlignUp(payload + HEADER_SIZE + MIN_BLOCK_SIZE, alignment);
+            block              = this->TrimLeadingFreeBlock(block, aligned - payload);
+        }
+    }
+
+    this->TrimFreeBlock(block, blockSize);
+    block->size &= ~FREE_BIT;
+
+    this->memoryUsed += GetBlockSize(block) + HEADER_SIZE;
+    this->memoryAllocationsCount++;
+
+    return GetPayload(block);
+}
+
+void ecs::memory::allocator::TLSFAllocator::Free(void* memory)
+{
+    assert(reinterpret_cast<uptr>(memory) > reinterpret_cast<uptr>(this->memoryAddress) &&
+           reinterpret_cast<uptr>(memory) < reinterpret_cast<uptr>(this->memoryAddress) + this->memorySize &&
+           "Memory was not allocated by this allocator.");
+
+    BlockHeader* block = GetBlock(memory);
+    assert(IsFree(block) == false && "Memory freed twice.");
+
+    this->memoryUsed -= GetBlockSize(block) + HEADER_SIZE;
+    this->memoryAllocationsCount--;
+
+    this->ReleaseBlock(block);
+}
+
+void ecs::memory::allocator::TLSFAllocator::ReleaseBlock(BlockHeader* block)
+{
+    // merge with the free neighbours, two free blocks are never adjacent
+    BlockHeader* prev = block->prevPhysical;
+    if (prev != nullptr && IsFree(prev) == true)
+    {
+        this->RemoveFreeBlock(prev);
+        prev->size = GetBlockSize(prev) + HEADER_SIZE + GetBlockSize(block);
+        block      = prev;
+    }
+
+    BlockHeader* next = GetNextPhysical(block);
+    if (IsFree(next) == true)
+    {
+        this->RemoveFreeBlock(next);
+        block->size = GetBlockSize(block) + HEADER_SIZE + GetBlockSize(next);
+    }
+
+    GetNextPhysical(block)->prevPhysical = block;
+    this->InsertFreeBlock(block);
+}
+
+void ecs::memory::allocator::TLSFAllocator::Clear()
+{
+    this->flBitmap = 0;
+    std::memset(this->slBitmap, 0, sizeof(this->slBitmap));
+    std::memset(this->freeBlocks, 0, sizeof(this->freeBlocks));
+
+    this->memoryUsed             = 0;
+    this->memoryAllocationsCount = 0;
+
+    this->sentinel = nullptr;
+
+    const uptr start = AlignUp(reinterpret_cast<uptr>(this->memoryAddress), ALIGNMENT);
+    const uptr end   = reinterpret_cast<uptr>(this->memoryAddress) + this->poolSize;
+
+    if (start + 2 * HEADER_SIZE + MIN_BLOCK_SIZE > end)
+    {
+        return;
+    }
+
+    // one free block spanning the whole memory, followed by the sentinel
+    BlockHeader* block  = reinterpret_cast<BlockHeader*>(start);
+    block->prevPhysical = nullptr;
+    block->size         = (end - start - 2 * HEADER_SIZE) & ~(ALIGNMENT - 1);
+
+    this->sentinel               = GetNextPhysical(block);
+    this->sentinel->prevPhysical = block;
+    this->sentinel->size         = 0;
+
+    this->InsertFreeBlock(block);
+}
+
+void ecs::memory::allocator::TLSFAllocator::Extend(const std::size_t size)
+{
+    this->poolSize = std::min(this->poolSize + size, this->memorySize);
+
+    if (this->sentinel == nullptr)
+    {
+        // the pool was too small to hold a block so far
+        this->Clear();
+        return;
+    }
+
+    const uptr start = reinterpret_cast<uptr>(this->sentinel);
+    const uptr end   = reinterpret_cast<uptr>(this->memoryAddress) + this->poolSize;
+
+    if (start + 2 * HEADER_SIZE + MIN_BLOCK_SIZE > end)
+    {
+        return;
+    }
+
+    // the old sentinel becomes a block covering the new memory, followed by a new sentinel
+    BlockHeader* block = this->sentinel;
+    block->size        = (end - start - 2 * HEADER_SIZE) & ~(ALIGNMENT - 1);
+
+    this->sentinel               = GetNextPhysical(block);
+    this->sentinel->prevPhysical = block;
+    this->sentinel->size         = 0;
+
+    this->ReleaseBlock(block);
+}
+
+std::size_t ecs::memory::allocator::TLSFAllocator::GetAllocationSize(const void* memory) const
+{
+    return GetBlockSize(GetBlock(memory));
+}
+
+std::size_t ecs::memory::allocator::TLSFAllocator::GetLargestFreeBlockSize() const
+{
+    if (this->flBitmap == 0)
+    {
+        return 0;
+    }
+
+    // blocks of the highest non-empty list are the largest, they differ within the list though
+    const u32 fl = FindLastSet(this->flBitmap);
+    const u32 sl = FindLastSet(this->slBitmap[fl]);
+
+    std::size_t largest = 0;
+    for (const BlockHeader* block = this->freeBlocks[fl][sl]; block != nullptr; block = block->nextFree)
+    {
+        largest = std::max(largest, GetBlockSize(block));
+    }
+
+    return largest;
+}
+
+void ecs::memory::allocator::TLSFAllocator::MappingInsert(std::size_t size, u32& fl, u32& sl)
+{
+    if (size < SMALL_BLOCK_SIZE)
+    {
+        // small sizes are split linearly, one list per ALIGNMENT step
+        fl = 0;
+        sl = static_cast<u32>(size >> ALIGNMENT_LOG2);
+    }
+    else
+    {
+        const u32 msb = FindLastSet(size);
+        sl            = static_cast<u32>(size >> (msb - SL_INDEX_COUNT_LOG2)) ^ (1u << SL_INDEX_COUNT_LOG2);
+        fl            = msb - static_cast<u32>(FL_INDEX_SHIFT - 1);
+    }
+}
+
+void ecs::memory::allocator::TLSFAllocator::MappingSearch(std::size_t size, u32& fl, u32& sl)
+{
+    // round up to the next list, so that any block of the found list fits
+    if (size >= SMALL_BLOCK_SIZE)
+    {
+        size += ((std::size_t)1 << (FindLastSet(size) - SL_INDEX_COUNT_LOG2)) - 1;
+    }
+
+    MappingInsert(size, fl, sl);
+}
+
+ecs::memory::allocator::TLSFAllocator::BlockHeader* ecs::memory::allocator::TLSFAllocator::FindFreeBlock(
+    std::size_t size)
+{
+    u32 fl, sl;
+    MappingSearch(size, fl, sl);
+
+    if (fl >= FL_INDEX_COUNT)
+    {
+        return nullptr;
+    }
+
+    u32 slMap = this->slBitmap[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        // take the smallest list of a larger first level
+        const u32 flMap = fl + 1 < 32 ? this->flBitmap & (~0u << (fl + 1)) : 0;
+        if (flMap == 0)
+        {
+            return nullptr;
+        }
+
+        fl    = FindFirstSet(flMap);
+        slMap = this->slBitmap[fl];
+    }
+
+    sl = FindFirstSet(slMap);
+
+    BlockHeader* block = this->freeBlocks[fl][sl];
+    this->RemoveFreeBlock(block);
+    return block;
+}
+
+void ecs::memory::allocator::TLSFAllocator::InsertFreeBlock(BlockHeader* block)
+{
+    u32 fl, sl;
+    MappingInsert(GetBlockSize(block), fl, sl);
+
+    BlockHeader* head = this->freeBlocks[fl][sl];
+
+    block->size |= FREE_BIT;
+    block->nextFree = head;
+    block->prevFree = nullptr;
+
+    if (head != nullptr)
+    {
+        head->prevFree = block;
+    }
+
+    this->freeBlocks[fl][sl] = block;
+    this->flBitmap |= 1u << fl;
+    this->slBitmap[fl] |= 1u << sl;
+}
+
+void ecs::memory::allocator::TLSFAllocator::RemoveFreeBlock(BlockHeader* block)
+{
+    u32 fl, sl;
+    MappingInsert(GetBlockSize(block), fl, sl);
+
+    if (block->prevFree != nullptr)
+    {
+        block->prevFree->nextFree = block->nextFree;
+    }
+
+    if (block->nextFree != nullptr)
+    {
+        block->nextFree->prevFree = block->prevFree;
+    }
+
+    if (this->freeBlocks[fl][sl] == block)
+    {
+        this->freeBlocks[fl][sl] = block->nextFree;
+
+        if (block->nextFree == nullptr)
+        {
+            this->slBitmap[fl] &= ~(1u << sl);
+            if (this->slBitmap[fl] == 0)
+            {
+                this->flBitmap &= ~(1u << fl);
+            }
+        }
+    }
+}
+
+void ecs::memory::allocator::TLSFAllocator::TrimFreeBlock(BlockHeader* block, std::size_t size)
+{
+    const std::size_t blockSize = GetBlockSize(block);
+    if (blockSize < size + HEADER_SIZE + MIN_BLOCK_SIZE)
+    {
+        return;
+    }
+
+    BlockHeader* remaining  = reinterpret_cast<BlockHeader*>((u8*)GetPayload(block) + size);
+    remaining->prevPhysical = block;
+    remaining->size         = blockSize - size - HEADER_SIZE;
+
+    GetNextPhysical(remaining)->prevPhysical = remaining;
+
+    block->size = size | (block->size & FREE_BIT);
+    this->InsertFreeBlock(remaining);
+}
+
+ecs::memory::allocator::TLSFAllocator::BlockHeader* ecs::memory::allocator::TLSFAllocator::TrimLeadingFreeBlock(
+    BlockHeader* block,
+    std::size_t  gap)
+{
+    // the leading part keeps the header, the remaining block gets a new one gap bytes further
+    BlockHeader* remaining  = reinterpret_cast<BlockHeader*>((u8*)block + gap);
+    remaining->prevPhysical = block;
+    remaining->size         = GetBlockSize(block) - gap;
+
+    GetNextPhysical(remaining)->prevPhysical = remaining;
+
+    block->size = gap - HEADER_SIZE;
+    this->InsertFreeBlock(block);
+
+    return remaining;
+}
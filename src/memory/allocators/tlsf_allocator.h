@@ -0,0 +1,122 @@
+#pragma once
+
+#include "memory/allocators/iallocator.hpp"
+
+namespace ecs
+{
+namespace memory
+{
+namespace allocator
+{
+
+class ECS_API TLSFAllocator final : public IAllocator
+{
+    /*
+     *   Two-level segregated fit allocator, allocates and frees in any order in O(1)
+     *
+     *   Free blocks are kept in lists indexed by the power of two of their size (first level) and a linear
+     *   subdivision of that range (second level), two bitmaps tell which lists are non-empty. Freed blocks are
+     *   merged with their free neighbours right away.
+     *
+     *     header   payload      header   payload      header
+     *       v        v            v        v            v
+     *     |===|=============|===|==========|...|===|
+     *     ^                                         ^
+     *     Initial                                   Sentinel block
+     *     memory                                    (never free, stops merging)
+     *     address
+     */
+
+public:
+    TLSFAllocator(const std::size_t memorySize, const void* memory);
+    // Only manages the first poolSize bytes of memory until Extend makes more of it available.
+    TLSFAllocator(const std::size_t memorySize, const void* memory, const std::size_t poolSize);
+    virtual ~TLSFAllocator();
+
+    virtual void* Allocate(const std::size_t size, const u8 alignment) override;
+    virtual void  Free(void* memory) override;
+    virtual void  Clear() override;
+
+    // Payload size of an allocation, at least the requested size.
+    std::size_t GetAllocationSize(const void* memory) const;
+
+    // Appends the next size bytes of memory to the pool, they have to be accessible from now on.
+    void Extend(const std::size_t size);
+
+    inline std::size_t GetPoolSize() const { return this->poolSize; }
+
+    // Payload size of the largest free block, the largest allocation that fits right now.
+    std::size_t GetLargestFreeBlockSize() const;
+
+private:
+    struct BlockHeader
+    {
+        // block right before this one in memory
+        BlockHeader* prevPhysical;
+        // payload size, the lowest bit marks free blocks
+        std::size_t size;
+        // free list links, only valid while the block is free, they overlap the payload otherwise
+        BlockHeader* nextFree;
+        BlockHeader* prevFree;
+    };
+
+    static constexpr std::size_t ALIGNMENT_LOG2 = sizeof(void*) == 8 ? 4 : 3;
+    static constexpr std::size_t ALIGNMENT      = (std::size_t)1 << ALIGNMENT_LOG2;
+    static constexpr std::size_t HEADER_SIZE    = 2 * sizeof(void*);
+    // a free block has to hold its free list links
+    static constexpr std::size_t MIN_BLOCK_SIZE = 2 * sizeof(void*);
+    static constexpr std::size_t FREE_BIT       = 1;
+
+    static constexpr std::size_t SL_INDEX_COUNT_LOG2 = 5;
+    static constexpr std::size_t SL_INDEX_COUNT      = (std::size_t)1 << SL_INDEX_COUNT_LOG2;
+    // sizes below SMALL_BLOCK_SIZE share the first list and are split linearly
+    static constexpr std::size_t FL_INDEX_SHIFT   = SL_INDEX_COUNT_LOG2 + ALIGNMENT_LOG2;
+    static constexpr std::size_t FL_INDEX_MAX     = sizeof(void*) == 8 ? 40 : 30;
+    static constexpr std::size_t FL_INDEX_COUNT   = FL_INDEX_MAX - FL_INDEX_SHIFT + 1;
+    static constexpr std::size_t SMALL_BLOCK_SIZE = (std::size_t)1 << FL_INDEX_SHIFT;
+    static constexpr std::size_t MAX_BLOCK_SIZE   = (std::size_t)1 << FL_INDEX_MAX;
+
+    static_assert(sizeof(BlockHeader) == HEADER_SIZE + MIN_BLOCK_SIZE, "Unexpected block header layout.");
+    static_assert(FL_INDEX_COUNT <= 32 && SL_INDEX_COUNT <= 32, "Free list bitmaps are 32 bit.");
+
+    static inline std::size_t GetBlockSize(const BlockHeader* block) { return block->size & ~FREE_BIT; }
+    static inline bool        IsFree(const BlockHeader* block) { return (block->size & FREE_BIT) != 0; }
+
+    static inline void* GetPayload(const BlockHeader* block) { return (u8*)block + HEADER_SIZE; }
+
+    static inline BlockHeader* GetBlock(const void* memory) { return (BlockHeader*)((u8*)memory - HEADER_SIZE); }
+
+    static inline BlockHeader* GetNextPhysical(const BlockHeader* block)
+    {
+        return (BlockHeader*)((u8*)block + HEADER_SIZE + GetBlockSize(block));
+    }
+
+    static void MappingInsert(std::size_t size, u32& fl, u32& sl);
+    static void MappingSearch(std::size_t size, u32& fl, u32& sl);
+
+    BlockHeader* FindFreeBlock(std::size_t size);
+
+    // Merges a block that became free with its free neighbours and lists the result.
+    void ReleaseBlock(BlockHeader* block);
+
+    void InsertFreeBlock(BlockHeader* block);
+    void RemoveFreeBlock(BlockHeader* block);
+
+    // Splits off everything behind size bytes of payload as a new free block if it is large enough.
+    void TrimFreeBlock(BlockHeader* block, std::size_t size);
+
+    // Splits off the first gap bytes of a block as a free block, returns the remaining block.
+    BlockHeader* TrimLeadingFreeBlock(BlockHeader* block, std::size_t gap);
+
+private:
+    std::size_t  poolSize;
+    // closes the pool, never free
+    BlockHeader* sentinel;
+    u32          flBitmap;
+    u32          slBitmap[FL_INDEX_COUNT];
+    BlockHeader* freeBlocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+};
+
+} // namespace allocator
+} // namespace memory
+} // namespace ecs
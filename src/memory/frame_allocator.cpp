@@ -0,0 +1,12 @@
+#include "memory/frame_allocator.h"
+
+ecs::memory::FrameAllocator::FrameAllocator(std::size_t memorySize)
+    : allocator(memorySize, GlobalMemoryUser::Allocate(memorySize, "FrameAllocator"))
+    , memoryResource(&this->allocator)
+{
+}
+
+ecs::memory::FrameAllocator::~FrameAllocator()
+{
+    GlobalMemoryUser::Free((void*)this->allocator.GetMemoryAddress());
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "api.h"
+#include "memory/allocators/linear_allocator.h"
+#include "memory/memory_resource.h"
+
+namespace ecs
+{
+namespace memory
+{
+
+// Summary:	Linear scratch memory of one thread that lives until the end of the current frame. Temporary buffers of
+//			systems come from here instead of the heap, everything is released at once by Reset.
+class ECS_API FrameAllocator : GlobalMemoryUser
+{
+public:
+    explicit FrameAllocator(std::size_t memorySize);
+    ~FrameAllocator();
+
+    // Returns nullptr once the frame's memory is used up.
+    inline void* Allocate(std::size_t size, u8 alignment) { return this->allocator.Allocate(size, alignment); }
+
+    template <class T>
+    inline T* Allocate(std::size_t count)
+    {
+        return static_cast<T*>(this->allocator.Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Releases all allocations of the frame.
+    inline void Reset() { this->allocator.Clear(); }
+
+    // For std::pmr containers, requests beyond the frame's memory fall back to the default resource.
+    inline std::pmr::memory_resource* GetMemoryResource() { return &this->memoryResource; }
+
+    inline std::size_t GetUsedMemory() const { return this->allocator.GetUsedMemory(); }
+    inline std::size_t GetMemorySize() const { return this->allocator.GetMemorySize(); }
+
+private:
+    FrameAllocator(const FrameAllocator&) = delete;
+    FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+private:
+    allocator::LinearAllocator                 allocator;
+    MemoryResource<allocator::LinearAllocator> memoryResource;
+};
+
+} // namespace memory
+} // namespace ecs
@@ -1,56 +1,146 @@
 #pragma once
 
+#include <atomic>
+#include <bitset>
 #include <cassert>
 #include <list>
 
 #include "api.h"
 #include "memory/allocators/pool_allocator.h"
+#include "memory/memory_debug.h"
+#include "memory/memory_resource.h"
+#include "memory/memory_stats.h"
+#include "memory/small_object.h"
 
 namespace ecs
 {
 namespace memory
 {
 
+// Summary:	When a MemoryChunkAllocator gives empty chunks back to the memory manager on its own. Off by default,
+//			chunks are kept until ShrinkToFit. With autoRelease, once more than maxEmptyChunks chunks are empty,
+//			empty chunks are released until keepEmptyChunks are left. The gap keeps a container that grows and
+//			shrinks around a chunk boundary from releasing and allocating a chunk over and over.
+struct ChunkReleasePolicy
+{
+    bool        autoRelease     = false;
+    std::size_t maxEmptyChunks  = ECS_CHUNK_MAX_EMPTY_CHUNKS;
+    std::size_t keepEmptyChunks = ECS_CHUNK_KEEP_EMPTY_CHUNKS;
+};
+
 template <class OBJECT_TYPE, std::size_t MAX_CHUNK_OBJECTS>
 class ECS_API MemoryChunkAllocator : protected memory::GlobalMemoryUser
 {
+    // Objects per chunk, CreateObject puts no more into a chunk even if its pool has room for them.
     static const std::size_t MAX_OBJECTS = MAX_CHUNK_OBJECTS;
 
-    // Byte size to fit approx. MAX_CHUNK_OBJECTS objects.
-    static const std::size_t ALLOCATE_SIZE = (sizeof(OBJECT_TYPE) + alignof(OBJECT_TYPE)) * MAX_OBJECTS;
+    // Objects are surrounded by guard bands in debug memory mode.
+    static const std::size_t SLOT_SIZE = sizeof(OBJECT_TYPE) + 2 * debug::GUARD_SIZE;
+    static_assert(debug::GUARD_SIZE % alignof(OBJECT_TYPE) == 0, "Guard bands break the object alignment.");
+
+    // Byte size to fit MAX_OBJECTS objects, whatever the alignment of the chunk memory.
+    static const std::size_t ALLOCATE_SIZE = (SLOT_SIZE + alignof(OBJECT_TYPE)) * MAX_OBJECTS;
+
+    // Upper bound of the slots the pool of a chunk is cut into.
+    static const std::size_t NUM_SLOTS = ALLOCATE_SIZE / SLOT_SIZE;
 
     const char* allocatorTag;
 
+    std::size_t numObjects;
+    std::size_t peakNumObjects;
+    std::size_t numEmptyChunks;
+
+    // capacity the chunks are not released below, see Reserve
+    std::size_t        reservedObjects;
+    ChunkReleasePolicy releasePolicy;
+
+    // node of the next chunk, chunks are spread evenly over the NUMA nodes
+    u32 nextNumaNode;
+
 public:
     using Allocator  = memory::allocator::PoolAllocator;
-    using ObjectList = std::list<OBJECT_TYPE*>;
+    using ObjectList = memory::internal::List<OBJECT_TYPE*>;
 
     // Summary:	Helper struct to capsule an allocator and object list. The
     // object list is used to keep track of objects start addresses in memory
-    // managed by the allocator.
-    class MemoryChunk
+    // managed by the allocator. The allocator is held by value, its final
+    // type lets the compiler inline the free list operations.
+    class MemoryChunk : public SmallObject
     {
     public:
-        Allocator* allocator;
+        Allocator  allocator;
         ObjectList objects;
 
         uptr chunkStart;
         uptr chunkEnd;
 
-        MemoryChunk(Allocator* allocaor)
-            : allocator(allocaor)
+        // NUMA node holding the chunk's memory
+        u32 numaNode;
+
+        // address of the pool's first slot and one bit per slot that holds an object
+        uptr                   firstSlot;
+        std::bitset<NUM_SLOTS> usedSlots;
+
+        // set whenever an object of the chunk is created, destroyed or handed out for writing, a digest of the
+        // objects cached in stateHash is valid while it stays cleared
+        std::atomic<bool> modified;
+        u64               stateHash;
+
+        MemoryChunk(const void* memory, u32 numaNode)
+            : allocator(ALLOCATE_SIZE, memory, SLOT_SIZE, alignof(OBJECT_TYPE))
+            , numaNode(numaNode)
+            , modified(true)
+            , stateHash(0)
         {
-            this->chunkStart = reinterpret_cast<uptr>(allocator->GetMemoryAddress());
+            this->chunkStart = reinterpret_cast<uptr>(this->allocator.GetMemoryAddress());
             this->chunkEnd   = this->chunkStart + ALLOCATE_SIZE;
+            this->firstSlot  = this->chunkStart + memory::allocator::GetAdjustment(memory, alignof(OBJECT_TYPE));
             this->objects.clear();
         }
 
+        inline std::size_t GetSlotIndex(const void* slot) const
+        {
+            return (reinterpret_cast<uptr>(slot) - this->firstSlot) / SLOT_SIZE;
+        }
+
+        // Calls func(object) for every object of the chunk in address order, i.e. in one pass over the memory.
+        template <class F>
+        void ForEachObjectInSlotOrder(const F& func) const
+        {
+            for (std::size_t i = 0; i < NUM_SLOTS; ++i)
+            {
+                if (this->usedSlots.test(i) == true)
+                {
+                    func(reinterpret_cast<const OBJECT_TYPE*>(this->firstSlot + i * SLOT_SIZE + debug::GUARD_SIZE));
+                }
+            }
+        }
+
     }; // class EntityMemoryChunk
 
-    using MemoryChunks = std::list<MemoryChunk*>;
+    using MemoryChunks = memory::internal::List<MemoryChunk*>;
+
+    static inline void* GuardObject(void* slot)
+    {
+#if ECS_MEMORY_DEBUG
+        return debug::GuardMemory(slot, sizeof(OBJECT_TYPE));
+#else
+        return slot;
+#endif
+    }
+
+    static inline void* UnguardObject(void* object)
+    {
+#if ECS_MEMORY_DEBUG
+        const bool intact = debug::UnguardMemory(object, sizeof(OBJECT_TYPE));
+        assert(intact == true && "Memory guard of an object was overwritten.");
+        (void)intact;
+#endif
+        return (u8*)object - debug::GUARD_SIZE;
+    }
 
     // Summary:	An iterator for linear search actions in allocated memory
-    // chungs.
+    // chungs. Empty chunks are skipped.
     class iterator : public std::iterator<std::forward_iterator_tag, OBJECT_TYPE>
     {
         typename MemoryChunks::iterator currentChunk;
@@ -58,13 +148,16 @@ public:
 
         typename ObjectList::iterator currentObject;
 
-    public:
-        iterator(typename MemoryChunks::iterator begin, typename MemoryChunks::iterator end)
-            : currentChunk(begin)
-            , end(end)
+        inline void SkipEmptyChunks()
         {
-            if (begin != end)
+            while (this->currentChunk != this->end && (*this->currentChunk)->objects.empty() == true)
+            {
+                this->currentChunk++;
+            }
+
+            if (this->currentChunk != this->end)
             {
+                // set object iterator to begin of next chunk list
                 assert((*this->currentChunk) != nullptr);
                 this->currentObject = (*this->currentChunk)->objects.begin();
             }
@@ -74,6 +167,14 @@ public:
             }
         }
 
+    public:
+        iterator(typename MemoryChunks::iterator begin, typename MemoryChunks::iterator end)
+            : currentChunk(begin)
+            , end(end)
+        {
+            this->SkipEmptyChunks();
+        }
+
         inline iterator& operator++()
         {
             // move to next object in current chunk
@@ -83,20 +184,23 @@ public:
             if (this->currentObject == (*this->currentChunk)->objects.end())
             {
                 this->currentChunk++;
-
-                if (this->currentChunk != this->end)
-                {
-                    // set object iterator to begin of next chunk list
-                    assert((*this->currentChunk) != nullptr);
-                    this->currentObject = (*this->currentChunk)->objects.begin();
-                }
+                this->SkipEmptyChunks();
             }
 
             return *this;
         }
 
-        inline OBJECT_TYPE& operator*() const { return *this->currentObject; }
-        inline OBJECT_TYPE* operator->() const { return *this->currentObject; }
+        // objects are handed out for writing
+        inline OBJECT_TYPE& operator*() const
+        {
+            (*this->currentChunk)->modified.store(true, std::memory_order_relaxed);
+            return **this->currentObject;
+        }
+        inline OBJECT_TYPE* operator->() const
+        {
+            (*this->currentChunk)->modified.store(true, std::memory_order_relaxed);
+            return *this->currentObject;
+        }
 
         inline bool operator==(iterator& other)
         {
@@ -115,12 +219,15 @@ protected:
 public:
     MemoryChunkAllocator(const char* allocatorTag = nullptr)
         : allocatorTag(allocatorTag)
+        , numObjects(0)
+        , peakNumObjects(0)
+        , numEmptyChunks(1)
+        , reservedObjects(0)
+        , nextNumaNode(0)
     {
 
-        // create initial chunk
-        Allocator* allocator = new Allocator(
-            ALLOCATE_SIZE, Allocate(ALLOCATE_SIZE, allocatorTag), sizeof(OBJECT_TYPE), alignof(OBJECT_TYPE));
-        this->chunks.push_back(new MemoryChunk(allocator));
+        // create initial chunk, there is always at least one
+        this->chunks.push_back(this->CreateChunk());
     }
 
     virtual ~MemoryChunkAllocator()
@@ -133,31 +240,38 @@ public:
 
             chunk->objects.clear();
 
-            // free allocated allocator memory
-            Free((void*)chunk->allocator->GetMemoryAddress());
-            delete chunk->allocator;
-            chunk->allocator = nullptr;
-
-            // delete helper chunk object
-            delete chunk;
-            chunk = nullptr;
+            this->DeleteChunk(chunk);
         }
     }
 
     void* CreateObject()
+    {
+        MemoryChunk* objectChunk = nullptr;
+        return this->CreateObject(objectChunk);
+    }
+
+    // Also returns the chunk the object was put into.
+    void* CreateObject(MemoryChunk*& objectChunk)
     {
         void* slot = nullptr;
 
         // get next free slot
         for (auto chunk : this->chunks)
         {
-            if (chunk->objects.size() > MAX_OBJECTS)
+            if (chunk->objects.size() >= MAX_OBJECTS)
                 continue;
 
-            slot = chunk->allocator->Allocate(sizeof(OBJECT_TYPE), alignof(OBJECT_TYPE));
+            slot = chunk->allocator.Allocate(SLOT_SIZE, alignof(OBJECT_TYPE));
             if (slot != nullptr)
             {
+                if (chunk->objects.empty() == true)
+                    --this->numEmptyChunks;
+
+                chunk->usedSlots.set(chunk->GetSlotIndex(slot));
+                chunk->modified.store(true, std::memory_order_relaxed);
+                slot = GuardObject(slot);
                 chunk->objects.push_back((OBJECT_TYPE*)slot);
+                objectChunk = chunk;
                 break;
             }
         }
@@ -165,20 +279,22 @@ public:
         // all chunks are full... allocate a new one
         if (slot == nullptr)
         {
-            Allocator* allocator = new Allocator(
-                ALLOCATE_SIZE, Allocate(ALLOCATE_SIZE, this->allocatorTag), sizeof(OBJECT_TYPE), alignof(OBJECT_TYPE));
-            MemoryChunk* newChunk = new MemoryChunk(allocator);
+            MemoryChunk* newChunk = this->CreateChunk();
 
             // put new chunk in front
             this->chunks.push_front(newChunk);
 
-            slot = newChunk->allocator->Allocate(sizeof(OBJECT_TYPE), alignof(OBJECT_TYPE));
+            slot = newChunk->allocator.Allocate(SLOT_SIZE, alignof(OBJECT_TYPE));
 
             assert(slot != nullptr && "Unable to create new object. Out of memory?!");
+            newChunk->usedSlots.set(newChunk->GetSlotIndex(slot));
+            slot = GuardObject(slot);
             newChunk->objects.clear();
             newChunk->objects.push_back((OBJECT_TYPE*)slot);
+            objectChunk = newChunk;
         }
 
+        this->peakNumObjects = std::max(this->peakNumObjects, ++this->numObjects);
         return slot;
     }
 
@@ -193,7 +309,19 @@ public:
                 // note: no need to call d'tor since it was called already by
                 // 'delete'
                 chunk->objects.remove((OBJECT_TYPE*)object);
-                chunk->allocator->Free(object);
+
+                void* slot = UnguardObject(object);
+                chunk->usedSlots.reset(chunk->GetSlotIndex(slot));
+                chunk->modified.store(true, std::memory_order_relaxed);
+                chunk->allocator.Free(slot);
+                --this->numObjects;
+
+                // the loop is left right away, releasing chunks doesn't hurt it
+                if (chunk->objects.empty() == true && ++this->numEmptyChunks > this->releasePolicy.maxEmptyChunks &&
+                    this->releasePolicy.autoRelease == true)
+                {
+                    this->ReleaseEmptyChunks(this->releasePolicy.keepEmptyChunks);
+                }
                 return;
             }
         }
@@ -201,9 +329,96 @@ public:
         assert(false && "Failed to delete object. Memory corruption?!");
     }
 
+    // Adds empty chunks until numObjects objects fit. The chunks are not released automatically while they are
+    // needed for numObjects objects, until the next Reserve or ShrinkToFit.
+    void Reserve(std::size_t numObjects)
+    {
+        this->reservedObjects = numObjects;
+        while (this->GetCapacity() < numObjects)
+        {
+            this->chunks.push_back(this->CreateChunk());
+            ++this->numEmptyChunks;
+        }
+    }
+
+    // Releases all empty chunks but the last one and drops the reservation.
+    void ShrinkToFit()
+    {
+        this->reservedObjects = 0;
+        this->ReleaseEmptyChunks(0);
+    }
+
+    void SetReleasePolicy(const ChunkReleasePolicy& releasePolicy)
+    {
+        this->releasePolicy = releasePolicy;
+        if (this->releasePolicy.autoRelease == true && this->numEmptyChunks > this->releasePolicy.maxEmptyChunks)
+        {
+            this->ReleaseEmptyChunks(this->releasePolicy.keepEmptyChunks);
+        }
+    }
+
+    inline const ChunkReleasePolicy& GetReleasePolicy() const { return this->releasePolicy; }
+
+    // Objects that fit into the current chunks.
+    inline std::size_t GetCapacity() const { return this->chunks.size() * MAX_OBJECTS; }
+
+    // Object and chunk counts, the type name is left to the caller.
+    MemoryPoolStats GetChunkStats() const
+    {
+        MemoryPoolStats stats{};
+        stats.objectSize     = sizeof(OBJECT_TYPE);
+        stats.numObjects     = this->numObjects;
+        stats.peakNumObjects = this->peakNumObjects;
+        stats.numChunks      = this->chunks.size();
+        stats.numEmptyChunks = this->numEmptyChunks;
+        stats.reservedMemory = stats.numChunks * ALLOCATE_SIZE;
+        stats.usedMemory     = stats.numObjects * sizeof(OBJECT_TYPE);
+        stats.occupancy      = stats.reservedMemory > 0 ? (f64)stats.usedMemory / (f64)stats.reservedMemory : 0.0;
+        return stats;
+    }
+
     inline iterator begin() { return iterator(this->chunks.begin(), this->chunks.end()); }
     inline iterator end() { return iterator(this->chunks.end(), this->chunks.end()); }
 
+private:
+    MemoryChunk* CreateChunk()
+    {
+        const u32 numaNode = this->nextNumaNode;
+        this->nextNumaNode = (this->nextNumaNode + 1) % this->GetNumaNodeCount();
+
+        return new MemoryChunk(AllocateChunk(ALLOCATE_SIZE, this->allocatorTag, numaNode), numaNode);
+    }
+
+    void DeleteChunk(MemoryChunk* chunk)
+    {
+        void* chunkMemory = (void*)chunk->allocator.GetMemoryAddress();
+
+        // delete helper chunk object
+        delete chunk;
+
+        // free allocated allocator memory
+        Free(chunkMemory);
+    }
+
+    void ReleaseEmptyChunks(std::size_t keepEmptyChunks)
+    {
+        auto it = this->chunks.begin();
+        while (it != this->chunks.end() && this->numEmptyChunks > keepEmptyChunks && this->chunks.size() > 1 &&
+               this->GetCapacity() - MAX_OBJECTS >= this->reservedObjects)
+        {
+            MemoryChunk* chunk = *it;
+            if (chunk->objects.empty() == false)
+            {
+                ++it;
+                continue;
+            }
+
+            it = this->chunks.erase(it);
+            this->DeleteChunk(chunk);
+            --this->numEmptyChunks;
+        }
+    }
+
 }; // MemoryChunkAllocator
 
 } // namespace memory
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstring>
+
+#include "api.h"
+
+//#define ECS_MEMORY_DEBUG 1
+
+// Debug memory mode: freed pool and linear memory is filled with a pattern, allocations of the global memory and
+// chunk objects are surrounded by guard bands checked on free and, in AddressSanitizer builds, free memory and
+// guard bands are poisoned. Nothing of it is compiled without ECS_MEMORY_DEBUG.
+#ifndef ECS_MEMORY_DEBUG
+#define ECS_MEMORY_DEBUG 0
+#endif
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ECS_ADDRESS_SANITIZER 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define ECS_ADDRESS_SANITIZER 1
+#endif
+#endif
+
+#if ECS_MEMORY_DEBUG && ECS_ADDRESS_SANITIZER
+#include <sanitizer/asan_interface.h>
+#define ECS_POISON_MEMORY(address, size) ASAN_POISON_MEMORY_REGION(address, size)
+#define ECS_UNPOISON_MEMORY(address, size) ASAN_UNPOISON_MEMORY_REGION(address, size)
+#else
+#define ECS_POISON_MEMORY(address, size) ((void)(address), (void)(size))
+#define ECS_UNPOISON_MEMORY(address, size) ((void)(address), (void)(size))
+#endif
+
+#if ECS_MEMORY_DEBUG
+#define ECS_MEMORY_GUARD_SIZE 16
+#else
+#define ECS_MEMORY_GUARD_SIZE 0
+#endif
+
+namespace ecs
+{
+namespace memory
+{
+namespace debug
+{
+
+static constexpr std::size_t GUARD_SIZE = ECS_MEMORY_GUARD_SIZE;
+
+static constexpr u8 GUARD_PATTERN     = 0xFD;
+static constexpr u8 ALLOCATED_PATTERN = 0xCD;
+static constexpr u8 FREED_PATTERN     = 0xDD;
+
+static inline bool CheckPattern(const void* memory, u8 pattern, std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (static_cast<const u8*>(memory)[i] != pattern)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#if ECS_MEMORY_DEBUG
+// Writes guard bands in front of and behind size bytes starting GUARD_SIZE bytes into memory and returns the guarded
+// memory. The front band begins with size, so that it can be read back by GetGuardedSize.
+static inline void* GuardMemory(void* memory, std::size_t size)
+{
+    u8* guarded = static_cast<u8*>(memory) + GUARD_SIZE;
+
+    std::memcpy(memory, &size, sizeof(std::size_t));
+    std::memset(static_cast<u8*>(memory) + sizeof(std::size_t), GUARD_PATTERN, GUARD_SIZE - sizeof(std::size_t));
+    std::memset(guarded + size, GUARD_PATTERN, GUARD_SIZE);
+
+    ECS_POISON_MEMORY(memory, GUARD_SIZE);
+    ECS_POISON_MEMORY(guarded + size, GUARD_SIZE);
+    return guarded;
+}
+
+static inline std::size_t GetGuardedSize(const void* guarded)
+{
+    const u8* memory = static_cast<const u8*>(guarded) - GUARD_SIZE;
+    ECS_UNPOISON_MEMORY(memory, sizeof(std::size_t));
+
+    std::size_t size;
+    std::memcpy(&size, memory, sizeof(std::size_t));
+    return size;
+}
+
+// Checks and removes the guard bands of memory returned by GuardMemory, returns false if they were overwritten.
+static inline bool UnguardMemory(void* guarded, std::size_t size)
+{
+    u8* memory = static_cast<u8*>(guarded) - GUARD_SIZE;
+
+    ECS_UNPOISON_MEMORY(memory, GUARD_SIZE);
+    ECS_UNPOISON_MEMORY(static_cast<u8*>(guarded) + size, GUARD_SIZE);
+
+    return GetGuardedSize(guarded) == size &&
+           CheckPattern(memory + sizeof(std::size_t), GUARD_PATTERN, GUARD_SIZE - sizeof(std::size_t)) &&
+           CheckPattern(static_cast<u8*>(guarded) + size, GUARD_PATTERN, GUARD_SIZE);
+}
+#endif
+
+} // namespace debug
+} // namespace memory
+} // namespace ecs
@@ -1,104 +1,532 @@
 #include "memory/memory_manager.h"
 
+#include <cstddef>
+#include <cstring>
+
+#include "memory/virtual_memory.h"
+#include "util/numa.h"
+
+namespace
+{
+inline std::size_t AlignUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+ecs::memory::internal::MemoryManager::Arena::Arena()
+    : reservedMemory(nullptr)
+    , reservedSize(0)
+    , memory(nullptr)
+    , capacity(0)
+    , commitGranularity(0)
+    , committedMemory(0)
+    , pageSize(0)
+    , hugePages(false)
+    , numaPlaced(false)
+    , peakUsedMemory(0)
+    , allocator(nullptr)
+{
+}
+
+bool ecs::memory::internal::MemoryManager::Arena::Reserve(std::size_t capacity,
+                                                          std::size_t commitGranularity,
+                                                          std::size_t pageSize,
+                                                          u32         numaNode)
+{
+    this->pageSize          = pageSize;
+    this->commitGranularity = AlignUp(std::max<std::size_t>(commitGranularity, 1), pageSize);
+    this->capacity          = AlignUp(capacity, this->commitGranularity);
+    this->committedMemory   = 0;
+
+    // over-reserve to start at a page boundary, huge pages are larger than the system's alignment guarantee
+    this->reservedSize   = this->capacity + pageSize;
+    this->reservedMemory = static_cast<u8*>(ReserveVirtualMemory(this->reservedSize, numaNode, &this->numaPlaced));
+    if (this->reservedMemory == nullptr)
+    {
+        this->reservedSize = 0;
+        this->capacity     = 0;
+        return false;
+    }
+
+    this->memory    = (u8*)AlignUp(reinterpret_cast<uptr>(this->reservedMemory), pageSize);
+    this->allocator = new TLSFAllocator(this->capacity, this->memory, 0);
+    return true;
+}
+
+void ecs::memory::internal::MemoryManager::Arena::Release()
+{
+    delete this->allocator;
+    this->allocator = nullptr;
+
+    if (this->reservedMemory != nullptr)
+    {
+        ReleaseVirtualMemory(this->reservedMemory, this->reservedSize);
+        this->reservedMemory = nullptr;
+    }
+
+    this->memory          = nullptr;
+    this->capacity        = 0;
+    this->committedMemory = 0;
+    this->numaPlaced      = false;
+    this->peakUsedMemory  = 0;
+}
+
+bool ecs::memory::internal::MemoryManager::Arena::Commit(std::size_t size)
+{
+    if (this->allocator == nullptr)
+    {
+        return false;
+    }
+
+    const std::size_t commitSize =
+        std::min(AlignUp(size, this->commitGranularity), this->capacity - this->committedMemory);
+
+    u8* commitMemory = this->memory + this->committedMemory;
+    if (commitSize == 0 || CommitVirtualMemory(commitMemory, commitSize) == false)
+    {
+        return false;
+    }
+
+    if (this->hugePages == true)
+    {
+        AdviseHugePages(commitMemory, commitSize);
+    }
+
+    this->committedMemory += commitSize;
+    this->allocator->Extend(commitSize);
+    return true;
+}
+
+void* ecs::memory::internal::MemoryManager::Arena::Allocate(std::size_t size, std::size_t alignment)
+{
+    // the range could not be reserved
+    if (this->allocator == nullptr)
+    {
+        return nullptr;
+    }
+
+    void* memory = this->allocator->Allocate(size, static_cast<u8>(alignment));
+
+    // the tail of the committed range grows until the allocation fits
+    while (memory == nullptr && this->Commit(size + alignment) == true)
+    {
+        memory = this->allocator->Allocate(size, static_cast<u8>(alignment));
+    }
+
+    this->peakUsedMemory = std::max(this->peakUsedMemory, this->allocator->GetUsedMemory());
+    return memory;
+}
+
+void ecs::memory::internal::MemoryManager::Arena::Free(void* memory, std::size_t decommitThreshold)
+{
+    const std::size_t size = this->allocator->GetAllocationSize(memory);
+    this->allocator->Free(memory);
+
+    if (size >= decommitThreshold)
+    {
+        // keep the first page, it holds the free list links of the block now
+        const uptr begin = AlignUp(reinterpret_cast<uptr>(memory) + 1, this->pageSize);
+        const uptr end   = (reinterpret_cast<uptr>(memory) + size) / this->pageSize * this->pageSize;
+
+        if (end > begin)
+        {
+            DecommitVirtualMemory(reinterpret_cast<void*>(begin), end - begin);
+        }
+    }
+}
+
+ecs::memory::MemoryArenaStats ecs::memory::internal::MemoryManager::Arena::GetStats() const
+{
+    MemoryArenaStats stats{};
+    if (this->allocator == nullptr)
+    {
+        return stats;
+    }
+
+    stats.reservedMemory   = this->capacity;
+    stats.committedMemory  = this->committedMemory;
+    stats.usedMemory       = this->allocator->GetUsedMemory();
+    stats.peakUsedMemory   = this->peakUsedMemory;
+    stats.freeMemory       = this->committedMemory - std::min(stats.usedMemory, this->committedMemory);
+    stats.largestFreeBlock = this->allocator->GetLargestFreeBlockSize();
+    stats.fragmentation =
+        stats.freeMemory > 0
+            ? 1.0 - (f64)std::min(stats.largestFreeBlock, stats.freeMemory) / (f64)stats.freeMemory
+            : 0.0;
+
+    return stats;
+}
+
 ecs::memory::internal::MemoryManager::MemoryManager()
+    : internalMemoryResource(this)
+    , internalMemory(0)
 {
     DEFINE_LOGGER("MemoryManager")
     LogInfo("Initialize MemoryManager!");
-    this->globalMemory = malloc(MemoryManager::MEMORY_CAPACITY);
-    if (this->globalMemory != nullptr)
+
+    this->Reserve();
+}
+
+ecs::memory::internal::MemoryManager::~MemoryManager()
+{
+    this->Release();
+}
+
+bool ecs::memory::internal::MemoryManager::Configure(const MemoryConfig& config)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (this->pendingMemory->empty() == false)
     {
+        LogError("Global memory can't be configured while it is in use.");
+        return false;
     }
-    else
+
+    this->pendingMemory.reset();
+    this->taggedMemory.reset();
+    if (this->internalMemory > 0)
     {
-        assert(this->globalMemory != nullptr && "Failed to allocate global memory.");
+        LogError("Global memory can't be configured while containers of the library are alive.");
+        this->pendingMemory.emplace(&this->internalMemoryResource);
+        this->taggedMemory.emplace(&this->internalMemoryResource);
+        return false;
     }
 
-    this->memoryAllocator = new StackAllocator(MemoryManager::MEMORY_CAPACITY, this->globalMemory);
-    assert(this->memoryAllocator != nullptr && "Failed to create memory allocator!");
+    this->Release();
+    this->config = config;
+    return this->Reserve();
+}
+
+bool ecs::memory::internal::MemoryManager::Reserve()
+{
+    const std::size_t pageSize = GetVirtualMemoryPageSize();
+
+    bool reserved = this->ReserveArena(this->globalArena, this->config.capacity, pageSize, ANY_NUMA_NODE, "global");
 
-    this->pendingMemory.clear();
-    this->freedMemory.clear();
+    // huge pages are only formed from aligned ranges, so the chunk memory is committed and decommitted in them
+    const std::size_t chunkPageSize = this->config.chunkHugePages == true ? GetHugePageSize() : pageSize;
+    const u32         numNodes      = this->config.numaAware == true ? util::GetNumaNodeCount() : 1;
+    const std::size_t nodeCapacity  = this->config.chunkCapacity / numNodes;
+
+    this->chunkArenas.resize(numNodes);
+    for (u32 node = 0; node < numNodes; ++node)
+    {
+        Arena& chunkArena = this->chunkArenas[node];
+
+        // pages committed later on are placed on the node, whichever thread touches them first
+        const u32 nodeId = numNodes > 1 ? util::GetNumaNodeId(node) : ANY_NUMA_NODE;
+
+        chunkArena.hugePages = this->config.chunkHugePages;
+        if (this->ReserveArena(chunkArena, nodeCapacity, chunkPageSize, nodeId, "chunk") == false)
+        {
+            reserved = false;
+            continue;
+        }
+
+        if (numNodes > 1 && chunkArena.numaPlaced == false)
+        {
+            LogWarning("Failed to place chunk memory on NUMA node %u.", nodeId);
+        }
+
+        if (this->config.chunkPrefaultSize > 0 && chunkArena.Commit(this->config.chunkPrefaultSize / numNodes) == true)
+        {
+            PrefaultVirtualMemory(chunkArena.memory, chunkArena.committedMemory);
+        }
+    }
+
+    if (this->config.chunkHugePages == true && IsHugePageSupported() == false)
+    {
+        LogWarning("Huge pages are not supported, chunk memory uses regular pages.");
+    }
+
+    this->pendingMemory.emplace(&this->internalMemoryResource);
+    this->taggedMemory.emplace(&this->internalMemoryResource);
+
+    std::size_t chunkCapacity = 0;
+    for (const Arena& chunkArena : this->chunkArenas)
+    {
+        chunkCapacity += chunkArena.capacity;
+    }
+
+    LogInfo("Reserved %zu bytes of global memory and %zu bytes of chunk memory on %u NUMA nodes.",
+            this->globalArena.capacity,
+            chunkCapacity,
+            numNodes);
+
+    return reserved;
 }
 
-ecs::memory::internal::MemoryManager::~MemoryManager()
+bool ecs::memory::internal::MemoryManager::ReserveArena(Arena&      arena,
+                                                        std::size_t capacity,
+                                                        std::size_t pageSize,
+                                                        u32         numaNode,
+                                                        const char* name)
 {
-    this->memoryAllocator->Clear();
-    delete this->memoryAllocator;
-    this->memoryAllocator = nullptr;
+    const std::size_t minCapacity = std::max(this->config.commitGranularity, pageSize);
 
-    free(this->globalMemory);
-    this->globalMemory = nullptr;
+    for (std::size_t size = capacity;; size /= 2)
+    {
+        if (arena.Reserve(size, this->config.commitGranularity, pageSize, numaNode) == true)
+        {
+            if (size < capacity)
+            {
+                LogWarning("Failed to reserve %zu bytes of %s memory, reserved %zu bytes.", capacity, name, size);
+            }
+            return true;
+        }
+
+        if (size <= minCapacity)
+        {
+            break;
+        }
+    }
+
+    LogFatal("Failed to reserve %s memory, not even %zu bytes of address space are available.", name, minCapacity);
+    return false;
+}
+
+void ecs::memory::internal::MemoryManager::Release()
+{
+    this->pendingMemory.reset();
+    this->taggedMemory.reset();
+
+    this->globalArena.Release();
+    for (Arena& chunkArena : this->chunkArenas)
+    {
+        chunkArena.Release();
+    }
+    this->chunkArenas.clear();
+}
+
+void* ecs::memory::internal::MemoryManager::Allocate(std::size_t memorySize, const char* user)
+{
+    return this->AllocateFrom(this->globalArena, memorySize, user);
+}
+
+void* ecs::memory::internal::MemoryManager::AllocateChunk(std::size_t memorySize, const char* user, u32 numaNode)
+{
+    return this->AllocateFrom(this->chunkArenas[numaNode % this->chunkArenas.size()], memorySize, user);
 }
 
-void* ecs::memory::internal::MemoryManager::Allocate(std::size_t memorySize, const std::string& user)
+void* ecs::memory::internal::MemoryManager::AllocateFrom(Arena& arena, std::size_t memorySize, const char* user)
 {
-    void* pointerMemory = memoryAllocator->Allocate(memorySize, alignof(u8));
-    this->pendingMemory.push_back(std::make_pair(user, pointerMemory));
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    void* pointerMemory = arena.Allocate(memorySize + 2 * debug::GUARD_SIZE, alignof(std::max_align_t));
+    if (pointerMemory == nullptr)
+    {
+        LogFatal("Out of global memory! \'%s\' requested %zu bytes.", user != nullptr ? user : "unknown", memorySize);
+        return nullptr;
+    }
+
+    const std::size_t allocationSize = arena.allocator->GetAllocationSize(pointerMemory);
+
+#if ECS_MEMORY_DEBUG
+    pointerMemory = debug::GuardMemory(pointerMemory, memorySize);
+#endif
+
+    this->pendingMemory->emplace(pointerMemory, user);
+
+    MemoryTagStats& tagStats = (*this->taggedMemory)[user];
+    tagStats.tag             = user != nullptr ? user : "unknown";
+    tagStats.usedMemory += allocationSize;
+    tagStats.peakUsedMemory = std::max(tagStats.peakUsedMemory, tagStats.usedMemory);
+    tagStats.numAllocations++;
+
     return pointerMemory;
 }
 
 void ecs::memory::internal::MemoryManager::Free(void* pointerMemory)
 {
-    if (pointerMemory == this->pendingMemory.back().second)
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    auto it = this->pendingMemory->find(pointerMemory);
+    if (it == this->pendingMemory->end())
     {
-        this->memoryAllocator->Free(pointerMemory);
-        this->pendingMemory.pop_back();
+        assert(false && "Memory was not allocated by the memory manager.");
+        return;
+    }
 
-        bool check = true;
-        while (check == true)
+    Arena* owner = &this->globalArena;
+    for (Arena& chunkArena : this->chunkArenas)
+    {
+        if (chunkArena.Contains(pointerMemory) == true)
         {
-            check = false;
+            owner = &chunkArena;
+            break;
+        }
+    }
 
-            const auto& it =
-                std::find_if(this->freedMemory.begin(),
-                             this->freedMemory.end(),
-                             [&](const void* pointer) { return pointer == this->pendingMemory.back().second; });
+    Arena& arena = *owner;
+    void*  block = (u8*)pointerMemory - debug::GUARD_SIZE;
 
-            if (it != this->freedMemory.end())
-            {
-                this->memoryAllocator->Free(pointerMemory);
-                this->pendingMemory.pop_back();
-                this->freedMemory.remove(*it);
+    const std::size_t allocationSize = arena.allocator->GetAllocationSize(block);
 
-                check = true;
-            }
-        }
+#if ECS_MEMORY_DEBUG
+    const std::size_t size = debug::GetGuardedSize(pointerMemory);
+    if (size > allocationSize - 2 * debug::GUARD_SIZE || debug::UnguardMemory(pointerMemory, size) == false)
+    {
+        LogFatal("\'%s\' wrote past the bounds of memory %p!",
+                 it->second != nullptr ? it->second : "unknown",
+                 pointerMemory);
+        assert(false && "Memory guard overwritten.");
     }
     else
     {
-        this->freedMemory.push_back(pointerMemory);
+        // allocators placed in the memory may have left parts of it poisoned
+        ECS_UNPOISON_MEMORY(pointerMemory, size);
+        std::memset(pointerMemory, debug::FREED_PATTERN, size);
+    }
+#endif
+
+    MemoryTagStats& tagStats = (*this->taggedMemory)[it->second];
+    tagStats.usedMemory -= allocationSize;
+    tagStats.numAllocations--;
+
+    this->pendingMemory->erase(it);
+
+    arena.Free(block, this->config.decommitThreshold);
+}
+
+void* ecs::memory::internal::MemoryManager::AllocateInternal(std::size_t size, std::size_t alignment)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    void* memory = nullptr;
+    if (this->globalArena.allocator != nullptr && alignment <= 128)
+    {
+        memory = this->globalArena.Allocate(size > 0 ? size : 1, alignment);
+    }
+
+    if (memory == nullptr)
+    {
+        return std::pmr::new_delete_resource()->allocate(size, alignment);
+    }
+
+    this->internalMemory += this->globalArena.allocator->GetAllocationSize(memory);
+    return memory;
+}
+
+void ecs::memory::internal::MemoryManager::FreeInternal(void* memory, std::size_t size, std::size_t alignment)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    if (this->globalArena.Contains(memory) == false)
+    {
+        std::pmr::new_delete_resource()->deallocate(memory, size, alignment);
+        return;
+    }
+
+    this->internalMemory -= this->globalArena.allocator->GetAllocationSize(memory);
+    this->globalArena.Free(memory, this->config.decommitThreshold);
+}
+
+ecs::memory::MemoryArenaStats ecs::memory::internal::MemoryManager::GetGlobalMemoryStats()
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return this->globalArena.GetStats();
+}
+
+ecs::memory::MemoryArenaStats ecs::memory::internal::MemoryManager::GetChunkMemoryStats()
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    MemoryArenaStats stats{};
+    for (const Arena& chunkArena : this->chunkArenas)
+    {
+        const MemoryArenaStats nodeStats = chunkArena.GetStats();
+
+        stats.reservedMemory += nodeStats.reservedMemory;
+        stats.committedMemory += nodeStats.committedMemory;
+        stats.usedMemory += nodeStats.usedMemory;
+        stats.peakUsedMemory += nodeStats.peakUsedMemory;
+        stats.freeMemory += nodeStats.freeMemory;
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, nodeStats.largestFreeBlock);
+    }
+
+    stats.fragmentation =
+        stats.freeMemory > 0 ? 1.0 - (f64)std::min(stats.largestFreeBlock, stats.freeMemory) / (f64)stats.freeMemory
+                             : 0.0;
+
+    return stats;
+}
+
+ecs::memory::MemoryArenaStats ecs::memory::internal::MemoryManager::GetChunkMemoryStats(u32 numaNode)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+    return numaNode < this->chunkArenas.size() ? this->chunkArenas[numaNode].GetStats() : MemoryArenaStats{};
+}
+
+std::size_t ecs::memory::internal::MemoryManager::GetCommittedMemory() const
+{
+    std::size_t committedMemory = this->globalArena.committedMemory;
+    for (const Arena& chunkArena : this->chunkArenas)
+    {
+        committedMemory += chunkArena.committedMemory;
+    }
+
+    return committedMemory;
+}
+
+std::size_t ecs::memory::internal::MemoryManager::GetUsedMemory() const
+{
+    std::size_t usedMemory = 0;
+    if (this->globalArena.allocator != nullptr)
+    {
+        usedMemory += this->globalArena.allocator->GetUsedMemory();
+    }
+
+    for (const Arena& chunkArena : this->chunkArenas)
+    {
+        if (chunkArena.allocator != nullptr)
+        {
+            usedMemory += chunkArena.allocator->GetUsedMemory();
+        }
+    }
+
+    return usedMemory;
+}
+
+void ecs::memory::internal::MemoryManager::GetTagStats(std::vector<MemoryTagStats>& stats)
+{
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
+
+    const std::size_t first = stats.size();
+    for (const auto& i : *this->taggedMemory)
+    {
+        // the same tag may be spelled at different addresses
+        auto it = std::find_if(stats.begin() + first, stats.end(), [&](const MemoryTagStats& tagStats) {
+            return std::strcmp(tagStats.tag, i.second.tag) == 0;
+        });
+
+        if (it == stats.end())
+        {
+            stats.push_back(i.second);
+            continue;
+        }
+
+        it->usedMemory += i.second.usedMemory;
+        it->peakUsedMemory += i.second.peakUsedMemory;
+        it->numAllocations += i.second.numAllocations;
     }
 }
 
 void ecs::memory::internal::MemoryManager::CheckMemoryLeaks()
 {
-    assert(!(this->freedMemory.size() > 0 && this->pendingMemory.size() == 0) && "Implementation failure");
+    std::lock_guard<std::recursive_mutex> lock(this->mutex);
 
-    if (this->pendingMemory.size() > 0)
+    if (this->pendingMemory->size() > 0)
     {
         LogFatal("!!!  M E M O R Y   L E A K   D E T E C T E D  !!!")
             LogFatal("!!!  M E M O R Y   L E A K   D E T E C T E D  !!!")
                 LogFatal("!!!  M E M O R Y   L E A K   D E T E C T E D  !!!")
 
-                    for (const auto& i : this->pendingMemory)
+                    for (const auto& i : *this->pendingMemory)
         {
-            bool isFreed = false;
-
-            isFreed = std::any_of(this->freedMemory.begin(),
-                                  this->freedMemory.end(),
-                                  [&i](const void* pointer)
-                                  {
-                                      if (pointer == i.second)
-                                      {
-                                          return true;
-                                      }
-                                      return false;
-                                  });
-
-            if (isFreed == false)
-            {
-                LogFatal("\'%s\' memory user didn't release allocated memory %p!", i.first.c_str(), i.second)
-            }
+            LogFatal("\'%s\' memory user didn't release allocated memory %p!",
+                     i.second != nullptr ? i.second : "unknown",
+                     i.first)
         }
     }
     else
@@ -1,42 +1,196 @@
 #pragma once
 
+#include <memory_resource>
+#include <mutex>
+#include <optional>
+#include <vector>
+
 #include "api.h"
 #include "log/logger_macro.h"
-#include "memory/allocators/stack_allocator.h"
+#include "memory/allocators/tlsf_allocator.h"
+#include "memory/memory_debug.h"
+#include "memory/memory_stats.h"
 
-#define ECS_GLOBAL_MEMORY_CAPACITY 134217728 // 128 MB
+#if defined(_WIN64) || defined(__x86_64__) || defined(__aarch64__) || defined(__LP64__)
+#define ECS_GLOBAL_MEMORY_CAPACITY 68719476736 // 64 GB of address space, only committed pages use memory
+#else
+#define ECS_GLOBAL_MEMORY_CAPACITY 536870912 // 512 MB
+#endif
+#define ECS_GLOBAL_MEMORY_COMMIT_GRANULARITY 2097152 // 2 MB
+#define ECS_GLOBAL_MEMORY_DECOMMIT_THRESHOLD 65536   // 64 KB
+#define ECS_CHUNK_MEMORY_CAPACITY ECS_GLOBAL_MEMORY_CAPACITY
 
 namespace ecs
 {
 namespace memory
 {
+
+// Summary:	Layout of the global memory. A range of capacity bytes is reserved up front and committed in steps of
+//			commitGranularity as allocations need it. Component and entity chunks are kept in a second range of
+//			chunkCapacity bytes, which can be backed by huge pages and split between the machine's NUMA nodes.
+struct ECS_API MemoryConfig
+{
+    std::size_t capacity          = ECS_GLOBAL_MEMORY_CAPACITY;
+    std::size_t commitGranularity = ECS_GLOBAL_MEMORY_COMMIT_GRANULARITY;
+    // freed allocations of at least this size give their pages back to the system
+    std::size_t decommitThreshold = ECS_GLOBAL_MEMORY_DECOMMIT_THRESHOLD;
+
+    // Upper bounds, a range that can't be reserved in full is halved until it can.
+    std::size_t chunkCapacity = ECS_CHUNK_MEMORY_CAPACITY;
+    // transparent huge pages for the chunk memory, fewer TLB misses when iterating large worlds
+    bool chunkHugePages = false;
+    // chunk memory committed and touched up front, so that the first frames don't fault it in
+    std::size_t chunkPrefaultSize = 0;
+    // one chunk range per NUMA node with memory, its pages placed on that node, chunkCapacity is split between them
+    bool numaAware = false;
+};
+
 namespace internal
 {
 
 class ECS_API MemoryManager
 {
-    using StackAllocator = allocator::StackAllocator;
+    using TLSFAllocator = allocator::TLSFAllocator;
 
     DECLARE_LOGGER
 
+    // Summary:	Reserved address range and the allocator over its committed part.
+    class Arena
+    {
+    public:
+        Arena();
+
+        // Places the pages on a NUMA node given by its system id, if it isn't ANY_NUMA_NODE.
+        bool Reserve(std::size_t capacity, std::size_t commitGranularity, std::size_t pageSize, u32 numaNode);
+        void Release();
+
+        // Commits the next pages of the reserved range for an allocation of at least size bytes.
+        bool Commit(std::size_t size);
+
+        void* Allocate(std::size_t size, std::size_t alignment);
+        void  Free(void* memory, std::size_t decommitThreshold);
+
+        inline bool Contains(const void* memory) const
+        {
+            return (const u8*)memory >= this->memory && (const u8*)memory < this->memory + this->capacity;
+        }
+
+        MemoryArenaStats GetStats() const;
+
+    public:
+        u8*            reservedMemory;
+        std::size_t    reservedSize;
+        u8*            memory;
+        std::size_t    capacity;
+        std::size_t    commitGranularity;
+        std::size_t    committedMemory;
+        // commits and decommits are aligned to it
+        std::size_t    pageSize;
+        bool           hugePages;
+        // the system took the NUMA node of Reserve
+        bool           numaPlaced;
+        std::size_t    peakUsedMemory;
+        TLSFAllocator* allocator;
+    };
+
+    // Summary:	Memory of the library's own containers. It comes from the global arena like any allocation, but
+    //			only the total is tracked instead of every single allocation.
+    class InternalMemoryResource : public std::pmr::memory_resource
+    {
+    public:
+        explicit InternalMemoryResource(MemoryManager* memoryManager)
+            : memoryManager(memoryManager)
+        {
+        }
+
+    protected:
+        virtual void* do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            return this->memoryManager->AllocateInternal(bytes, alignment);
+        }
+
+        virtual void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+        {
+            this->memoryManager->FreeInternal(memory, bytes, alignment);
+        }
+
+        virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        MemoryManager* memoryManager;
+    };
+
+    using PendingMemory = std::pmr::unordered_map<void*, const char*>;
+    using TaggedMemory  = std::pmr::unordered_map<const char*, MemoryTagStats>;
+
 public:
     MemoryManager();
     ~MemoryManager();
 
-    void* Allocate(std::size_t memorySize, const std::string& user = "");
+    void* Allocate(std::size_t memorySize, const char* user = nullptr);
+
+    // Allocates from the chunk memory of a NUMA node, meant for large long living blocks of objects.
+    void* AllocateChunk(std::size_t memorySize, const char* user = nullptr, u32 numaNode = 0);
 
     void Free(void* pointerMemory);
 
     void CheckMemoryLeaks();
 
-public:
-    static constexpr std::size_t MEMORY_CAPACITY = ECS_GLOBAL_MEMORY_CAPACITY;
+    // Reserves the global memory anew, fails while memory is allocated or if not even part of it can be reserved.
+    bool Configure(const MemoryConfig& config);
+
+    inline const MemoryConfig& GetConfig() const { return this->config; }
+
+    // Resource of the library's own containers, see memory::internal::InternalAllocator.
+    inline std::pmr::memory_resource* GetInternalMemoryResource() { return &this->internalMemoryResource; }
+
+    inline std::size_t GetInternalMemory() const { return this->internalMemory; }
+
+    // Nodes the chunk memory is split between, 1 unless MemoryConfig::numaAware is set on a NUMA machine.
+    inline u32 GetNumaNodeCount() const { return static_cast<u32>(this->chunkArenas.size()); }
+
+    std::size_t GetCommittedMemory() const;
+    std::size_t GetUsedMemory() const;
+
+    MemoryArenaStats GetGlobalMemoryStats();
+    // Stats of the chunk memory of all nodes, the peak is the sum of the nodes' peaks.
+    MemoryArenaStats GetChunkMemoryStats();
+    MemoryArenaStats GetChunkMemoryStats(u32 numaNode);
+
+    // Appends the memory of every user tag. Tags with equal names are merged, their peaks are summed.
+    void GetTagStats(std::vector<MemoryTagStats>& stats);
+
+private:
+    // Returns false if an arena could not be reserved at all, it hands out no memory then.
+    bool Reserve();
+    void Release();
+
+    // Halves the capacity until the address space can be reserved, e.g. under ulimit -v or strict overcommit.
+    bool ReserveArena(Arena& arena, std::size_t capacity, std::size_t pageSize, u32 numaNode, const char* name);
+
+    void* AllocateFrom(Arena& arena, std::size_t memorySize, const char* user);
+
+    // Falls back to the heap while the global arena is unavailable or full.
+    void* AllocateInternal(std::size_t size, std::size_t alignment);
+    void  FreeInternal(void* memory, std::size_t size, std::size_t alignment);
 
 private:
-    void*                                            globalMemory;
-    StackAllocator*                                  memoryAllocator;
-    std::vector<std::pair<const std::string, void*>> pendingMemory;
-    std::list<void*>                                 freedMemory;
+    MemoryConfig       config;
+    Arena              globalArena;
+    // indexed by NUMA node
+    std::vector<Arena> chunkArenas;
+
+    // recursive, the bookkeeping of an allocation allocates itself
+    std::recursive_mutex   mutex;
+    InternalMemoryResource internalMemoryResource;
+    std::size_t            internalMemory;
+
+    // live allocations and the tag of their user, exist while the arenas are reserved
+    std::optional<PendingMemory> pendingMemory;
+    std::optional<TaggedMemory>  taggedMemory;
 
     MemoryManager(const MemoryManager&) = delete;
     MemoryManager& operator=(MemoryManager&) = delete;
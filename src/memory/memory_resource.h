@@ -0,0 +1,141 @@
+#pragma once
+
+#include <list>
+#include <memory_resource>
+#include <unordered_map>
+#include <vector>
+
+#include "api.h"
+#include "memory/allocators/linear_allocator.h"
+#include "memory/allocators/pool_allocator.h"
+#include "memory/allocators/stack_allocator.h"
+
+namespace ecs
+{
+namespace memory
+{
+
+// Summary:	Lets standard containers allocate from one of our allocators through std::pmr. Requests the allocator
+//			can't serve are passed on to the upstream resource, deallocations are routed back by address. Linear
+//			memory is only released by Clear, stack memory has to be released in reverse order and pools only
+//			serve requests that fit their object size.
+template <class ALLOCATOR>
+class MemoryResource : public std::pmr::memory_resource
+{
+public:
+    explicit MemoryResource(ALLOCATOR*                 allocator,
+                            std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+        : allocator(allocator)
+        , upstream(upstream)
+    {
+    }
+
+    inline ALLOCATOR*                 GetAllocator() const { return this->allocator; }
+    inline std::pmr::memory_resource* GetUpstream() const { return this->upstream; }
+
+    inline bool Owns(const void* memory) const
+    {
+        const uptr address = reinterpret_cast<uptr>(memory);
+        const uptr begin   = reinterpret_cast<uptr>(this->allocator->GetMemoryAddress());
+        return address >= begin && address < begin + this->allocator->GetMemorySize();
+    }
+
+protected:
+    virtual void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* memory = nullptr;
+
+        if constexpr (std::is_base_of<allocator::PoolAllocator, ALLOCATOR>::value)
+        {
+            if (bytes <= this->allocator->GetObjectSize() && alignment <= this->allocator->GetObjectAlignment())
+            {
+                memory = this->allocator->Allocate(this->allocator->GetObjectSize(),
+                                                   this->allocator->GetObjectAlignment());
+            }
+        }
+        else if (alignment <= 128)
+        {
+            // our allocators take alignments up to 128 and no empty requests
+            memory = this->allocator->Allocate(bytes > 0 ? bytes : 1, static_cast<u8>(alignment));
+        }
+
+        return memory != nullptr ? memory : this->upstream->allocate(bytes, alignment);
+    }
+
+    virtual void do_deallocate(void* memory, std::size_t bytes, std::size_t alignment) override
+    {
+        if (this->Owns(memory) == false)
+        {
+            this->upstream->deallocate(memory, bytes, alignment);
+            return;
+        }
+
+        if constexpr (std::is_base_of<allocator::LinearAllocator, ALLOCATOR>::value == false)
+        {
+            this->allocator->Free(memory);
+        }
+    }
+
+    virtual bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+private:
+    ALLOCATOR*                 allocator;
+    std::pmr::memory_resource* upstream;
+};
+
+namespace internal
+{
+
+// Resource of the library's own containers, backed by the global memory.
+ECS_API std::pmr::memory_resource* GetInternalMemoryResource();
+
+// Summary:	Stateless standard allocator over the internal memory resource, so that containers of the library
+//			don't need a resource passed to their constructor.
+template <class T>
+class InternalAllocator
+{
+public:
+    using value_type = T;
+
+    InternalAllocator() = default;
+
+    template <class U>
+    InternalAllocator(const InternalAllocator<U>&)
+    {
+    }
+
+    inline T* allocate(std::size_t count)
+    {
+        return static_cast<T*>(GetInternalMemoryResource()->allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    inline void deallocate(T* memory, std::size_t count)
+    {
+        GetInternalMemoryResource()->deallocate(memory, sizeof(T) * count, alignof(T));
+    }
+
+    template <class U>
+    inline bool operator==(const InternalAllocator<U>&) const
+    {
+        return true;
+    }
+
+    template <class U>
+    inline bool operator!=(const InternalAllocator<U>&) const
+    {
+        return false;
+    }
+};
+
+template <class T>
+using Vector = std::vector<T, InternalAllocator<T>>;
+
+template <class T>
+using List = std::list<T, InternalAllocator<T>>;
+
+template <class K, class V, class H = std::hash<K>, class E = std::equal_to<K>>
+using UnorderedMap = std::unordered_map<K, V, H, E, InternalAllocator<std::pair<const K, V>>>;
+
+} // namespace internal
+} // namespace memory
+} // namespace ecs
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "api.h"
+
+namespace ecs
+{
+namespace memory
+{
+
+// Summary:	Usage of one of the memory manager's address ranges, see MemoryConfig.
+struct MemoryArenaStats
+{
+    std::size_t reservedMemory;
+    std::size_t committedMemory;
+    // allocations including their block headers
+    std::size_t usedMemory;
+    std::size_t peakUsedMemory;
+    // committed memory not used by allocations
+    std::size_t freeMemory;
+    std::size_t largestFreeBlock;
+    // 0 when all free memory is one block, towards 1 the more it is split into small blocks
+    f64         fragmentation;
+};
+
+// Summary:	Global memory allocated under one user tag, see GlobalMemoryUser::Allocate.
+struct MemoryTagStats
+{
+    const char* tag;
+    std::size_t usedMemory;
+    std::size_t peakUsedMemory;
+    std::size_t numAllocations;
+};
+
+// Summary:	Objects of one component or entity type and the chunks holding them.
+struct MemoryPoolStats
+{
+    const char* typeName;
+    std::size_t objectSize;
+    std::size_t numObjects;
+    std::size_t peakNumObjects;
+    std::size_t numChunks;
+    // chunks without objects, kept for later objects until the type's ChunkReleasePolicy releases them
+    std::size_t numEmptyChunks;
+    std::size_t reservedMemory;
+    std::size_t usedMemory;
+    // share of the chunk memory holding live objects
+    f64         occupancy;
+};
+
+} // namespace memory
+} // namespace ecs
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "api.h"
+
+namespace ecs
+{
+namespace memory
+{
+
+// Summary:	Base of the library's small heap objects, new and delete go through the small object allocator instead
+//			of the system heap. Objects are deleted with their size, deleting through a base needs a virtual destructor.
+class ECS_API SmallObject
+{
+public:
+    static void* operator new(std::size_t size);
+    static void  operator delete(void* memory, std::size_t size);
+
+    // placement new still constructs in memory provided by the caller
+    static inline void* operator new(std::size_t, void* memory) { return memory; }
+    static inline void  operator delete(void*, void*) {}
+};
+
+} // namespace memory
+} // namespace ecs
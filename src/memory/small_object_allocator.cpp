@@ -0,0 +1,414 @@
+#include "memory/small_object_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <new>
+#include <thread>
+
+#include "memory/small_object.h"
+
+namespace ecs
+{
+namespace memory
+{
+namespace internal
+{
+
+// Summary:	Free objects of one thread, linked through their first bytes. Flushed back to the slabs when the thread
+//			exits or the owner is trimmed. The lock is only contended while another thread trims.
+struct SmallObjectCache
+{
+    SmallObjectAllocator* owner = nullptr;
+    void*                 lists[SmallObjectAllocator::NUM_SIZE_CLASSES]  = {};
+    u32                   counts[SmallObjectAllocator::NUM_SIZE_CLASSES] = {};
+    std::atomic_flag      locked                                          = ATOMIC_FLAG_INIT;
+
+    ~SmallObjectCache()
+    {
+        if (this->owner != nullptr)
+        {
+            this->owner->UnregisterCache(this);
+        }
+    }
+
+    inline void Lock()
+    {
+        while (this->locked.test_and_set(std::memory_order_acquire) == true)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    inline void Unlock() { this->locked.clear(std::memory_order_release); }
+
+    // The lock has to be held.
+    void Flush()
+    {
+        for (u32 i = 0; i < SmallObjectAllocator::NUM_SIZE_CLASSES; ++i)
+        {
+            if (this->lists[i] != nullptr)
+            {
+                this->owner->FreeBatch(i, this->lists[i]);
+            }
+
+            this->lists[i]  = nullptr;
+            this->counts[i] = 0;
+        }
+    }
+};
+
+namespace
+{
+
+thread_local SmallObjectCache smallObjectCache;
+
+class SmallObjectCacheLock
+{
+public:
+    explicit SmallObjectCacheLock(SmallObjectCache& cache)
+        : cache(cache)
+    {
+        this->cache.Lock();
+    }
+
+    ~SmallObjectCacheLock() { this->cache.Unlock(); }
+
+private:
+    SmallObjectCache& cache;
+};
+
+// slab memory in front of the pool, keeps the pool's objects aligned
+constexpr std::size_t SLAB_HEADER_SIZE = (sizeof(allocator::PoolAllocator) + 15) / 16 * 16;
+
+inline void*& NextObject(void* object)
+{
+    return *static_cast<void**>(object);
+}
+
+} // namespace
+
+SmallObjectAllocator::SmallObjectAllocator()
+{
+    for (SizeClass& sizeClass : this->sizeClasses)
+    {
+        sizeClass.current = 0;
+        sizeClass.spare   = nullptr;
+    }
+}
+
+SmallObjectAllocator::~SmallObjectAllocator()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->cachesMutex);
+
+        for (SmallObjectCache* cache : this->caches)
+        {
+            SmallObjectCacheLock cacheLock(*cache);
+            cache->Flush();
+            cache->owner = nullptr;
+        }
+
+        this->caches.clear();
+    }
+
+    for (SizeClass& sizeClass : this->sizeClasses)
+    {
+        while (sizeClass.slabs.empty() == false)
+        {
+            this->ReleaseSlab(sizeClass, sizeClass.slabs.back());
+        }
+    }
+}
+
+void* SmallObjectAllocator::Allocate(std::size_t size)
+{
+    if (size > MAX_SIZE)
+    {
+        return GetInternalMemoryResource()->allocate(size, alignof(std::max_align_t));
+    }
+
+    const u32 sizeClass = GetSizeClass(size);
+
+    SmallObjectCache& cache = smallObjectCache;
+    if (cache.owner != this)
+    {
+        if (cache.owner != nullptr)
+        {
+            // the thread's cache belongs to another allocator
+            void* object = nullptr;
+            return this->AllocateBatch(sizeClass, object, 1) > 0 ? object : nullptr;
+        }
+
+        this->RegisterCache(&cache);
+    }
+
+    SmallObjectCacheLock lock(cache);
+
+    if (cache.lists[sizeClass] == nullptr)
+    {
+        cache.counts[sizeClass] = this->AllocateBatch(sizeClass, cache.lists[sizeClass], CACHE_BATCH_SIZE);
+        if (cache.counts[sizeClass] == 0)
+        {
+            return nullptr;
+        }
+    }
+
+    void* object            = cache.lists[sizeClass];
+    cache.lists[sizeClass]  = NextObject(object);
+    cache.counts[sizeClass] -= 1;
+    return object;
+}
+
+void SmallObjectAllocator::Free(void* memory, std::size_t size)
+{
+    if (memory == nullptr)
+    {
+        return;
+    }
+
+    if (size > MAX_SIZE)
+    {
+        GetInternalMemoryResource()->deallocate(memory, size, alignof(std::max_align_t));
+        return;
+    }
+
+    const u32 sizeClass = GetSizeClass(size);
+
+    SmallObjectCache& cache = smallObjectCache;
+    if (cache.owner != this)
+    {
+        NextObject(memory) = nullptr;
+        this->FreeBatch(sizeClass, memory);
+        return;
+    }
+
+    SmallObjectCacheLock lock(cache);
+
+    NextObject(memory)     = cache.lists[sizeClass];
+    cache.lists[sizeClass] = memory;
+
+    if (++cache.counts[sizeClass] < 2 * CACHE_BATCH_SIZE)
+    {
+        return;
+    }
+
+    // keep the most recently freed half, they are likely still in the cache
+    void* last = cache.lists[sizeClass];
+    for (u32 i = 1; i < CACHE_BATCH_SIZE; ++i)
+    {
+        last = NextObject(last);
+    }
+
+    void* batch             = NextObject(last);
+    NextObject(last)        = nullptr;
+    cache.counts[sizeClass] = CACHE_BATCH_SIZE;
+
+    this->FreeBatch(sizeClass, batch);
+}
+
+void SmallObjectAllocator::Trim()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->cachesMutex);
+
+        for (SmallObjectCache* cache : this->caches)
+        {
+            SmallObjectCacheLock cacheLock(*cache);
+            cache->Flush();
+        }
+    }
+
+    for (SizeClass& sizeClass : this->sizeClasses)
+    {
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+
+        for (std::size_t i = sizeClass.slabs.size(); i > 0; --i)
+        {
+            Slab* slab = sizeClass.slabs[i - 1];
+            if (slab->GetUsedMemory() == 0)
+            {
+                this->ReleaseSlab(sizeClass, slab);
+            }
+        }
+    }
+}
+
+std::size_t SmallObjectAllocator::GetSlabCount()
+{
+    std::size_t count = 0;
+    for (SizeClass& sizeClass : this->sizeClasses)
+    {
+        std::lock_guard<std::mutex> lock(sizeClass.mutex);
+        count += sizeClass.slabs.size();
+    }
+
+    return count;
+}
+
+void SmallObjectAllocator::RegisterCache(SmallObjectCache* cache)
+{
+    std::lock_guard<std::mutex> lock(this->cachesMutex);
+
+    cache->owner = this;
+    this->caches.push_back(cache);
+}
+
+void SmallObjectAllocator::UnregisterCache(SmallObjectCache* cache)
+{
+    std::lock_guard<std::mutex> lock(this->cachesMutex);
+
+    {
+        SmallObjectCacheLock cacheLock(*cache);
+        cache->Flush();
+        cache->owner = nullptr;
+    }
+
+    this->caches.erase(std::find(this->caches.begin(), this->caches.end(), cache));
+}
+
+u32 SmallObjectAllocator::AllocateBatch(u32 sizeClassIndex, void*& list, u32 count)
+{
+    SizeClass&        sizeClass = this->sizeClasses[sizeClassIndex];
+    const std::size_t size      = GetClassSize(sizeClassIndex);
+
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+
+    u32 taken = 0;
+    while (taken < count)
+    {
+        if (sizeClass.current >= sizeClass.slabs.size() && this->AcquireSlab(sizeClass, sizeClassIndex) == nullptr)
+        {
+            break;
+        }
+
+        Slab* slab   = sizeClass.slabs[sizeClass.current];
+        void* object = slab->Allocate(size, slab->GetObjectAlignment());
+        if (object == nullptr)
+        {
+            // slabs in front of current are full
+            ++sizeClass.current;
+            continue;
+        }
+
+        if (slab == sizeClass.spare)
+        {
+            sizeClass.spare = nullptr;
+        }
+
+        NextObject(object) = list;
+        list               = object;
+        ++taken;
+    }
+
+    return taken;
+}
+
+void SmallObjectAllocator::FreeBatch(u32 sizeClassIndex, void* list)
+{
+    SizeClass& sizeClass = this->sizeClasses[sizeClassIndex];
+
+    std::lock_guard<std::mutex> lock(sizeClass.mutex);
+
+    while (list != nullptr)
+    {
+        void* object = list;
+        list         = NextObject(object);
+
+        const std::size_t index = this->FindSlab(sizeClass, object);
+        assert(index < sizeClass.slabs.size() && "Object was not allocated by the small object allocator.");
+
+        Slab* slab = sizeClass.slabs[index];
+        slab->Free(object);
+
+        sizeClass.current = std::min(sizeClass.current, index);
+        if (slab->GetUsedMemory() > 0)
+        {
+            continue;
+        }
+
+        // one empty slab is kept, so that a class alternating around a slab boundary doesn't acquire and release
+        if (sizeClass.spare == nullptr || sizeClass.spare == slab)
+        {
+            sizeClass.spare = slab;
+        }
+        else
+        {
+            this->ReleaseSlab(sizeClass, slab);
+        }
+    }
+}
+
+SmallObjectAllocator::Slab* SmallObjectAllocator::AcquireSlab(SizeClass& sizeClass, u32 sizeClassIndex)
+{
+    u8* memory = static_cast<u8*>(GetInternalMemoryResource()->allocate(ECS_SMALL_OBJECT_SLAB_SIZE, 16));
+    if (memory == nullptr)
+    {
+        return nullptr;
+    }
+
+    const std::size_t size      = GetClassSize(sizeClassIndex);
+    const u8          alignment = static_cast<u8>(std::min<std::size_t>(size, 16));
+
+    Slab* slab = new (memory)
+        Slab(ECS_SMALL_OBJECT_SLAB_SIZE - SLAB_HEADER_SIZE, memory + SLAB_HEADER_SIZE, size, alignment);
+
+    auto it           = std::upper_bound(sizeClass.slabs.begin(), sizeClass.slabs.end(), slab);
+    sizeClass.current = static_cast<std::size_t>(it - sizeClass.slabs.begin());
+    sizeClass.slabs.insert(it, slab);
+
+    return slab;
+}
+
+void SmallObjectAllocator::ReleaseSlab(SizeClass& sizeClass, Slab* slab)
+{
+    auto it = std::lower_bound(sizeClass.slabs.begin(), sizeClass.slabs.end(), slab);
+    assert(it != sizeClass.slabs.end() && *it == slab);
+
+    sizeClass.slabs.erase(it);
+    sizeClass.current = 0;
+    if (sizeClass.spare == slab)
+    {
+        sizeClass.spare = nullptr;
+    }
+
+    slab->~Slab();
+    GetInternalMemoryResource()->deallocate(slab, ECS_SMALL_OBJECT_SLAB_SIZE, 16);
+}
+
+std::size_t SmallObjectAllocator::FindSlab(const SizeClass& sizeClass, const void* object) const
+{
+    // last slab starting at or before the object
+    auto it = std::upper_bound(sizeClass.slabs.begin(), sizeClass.slabs.end(), object, [](const void* o, Slab* s) {
+        return reinterpret_cast<uptr>(o) < reinterpret_cast<uptr>(s);
+    });
+
+    if (it == sizeClass.slabs.begin() ||
+        reinterpret_cast<uptr>(object) >= reinterpret_cast<uptr>(*(it - 1)) + ECS_SMALL_OBJECT_SLAB_SIZE)
+    {
+        return sizeClass.slabs.size();
+    }
+
+    return static_cast<std::size_t>(it - sizeClass.slabs.begin()) - 1;
+}
+
+} // namespace internal
+
+void* SmallObject::operator new(std::size_t size)
+{
+    void* memory = internal::ecsSmallObjectAllocator->Allocate(size);
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void SmallObject::operator delete(void* memory, std::size_t size)
+{
+    internal::ecsSmallObjectAllocator->Free(memory, size);
+}
+
+} // namespace memory
+} // namespace ecs
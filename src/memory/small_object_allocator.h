@@ -0,0 +1,108 @@
+#pragma once
+
+#include <mutex>
+
+#include "api.h"
+#include "memory/allocators/pool_allocator.h"
+#include "memory/memory_resource.h"
+
+namespace ecs
+{
+namespace memory
+{
+namespace internal
+{
+
+struct SmallObjectCache;
+
+// Summary:	Allocator of the library's small objects. Sizes up to MAX_SIZE bytes are rounded up to a power of two
+//			size class, each class is served from pools of ECS_SMALL_OBJECT_SLAB_SIZE bytes taken from the global
+//			memory. Every thread caches a few free objects per class, so that most allocations and frees don't lock.
+//			The caches are registered with the allocator, Trim drains those of all threads. The allocator has to
+//			outlive all threads that used it.
+class ECS_API SmallObjectAllocator
+{
+    friend struct SmallObjectCache;
+
+    // the pool's allocator object sits at the start of the slab's memory
+    using Slab = allocator::PoolAllocator;
+
+    // sorted by address, to find the slab of a freed object
+    using Slabs = Vector<Slab*>;
+
+    struct SizeClass
+    {
+        std::mutex  mutex;
+        Slabs       slabs;
+        // first slab that may have free objects
+        std::size_t current;
+        // an empty slab kept for the next allocations, further empty slabs are released
+        Slab*       spare;
+    };
+
+public:
+    static constexpr std::size_t MIN_SIZE         = 8;
+    static constexpr std::size_t MAX_SIZE         = 256;
+    static constexpr u32         NUM_SIZE_CLASSES = 6;
+
+    // objects moved between a thread's cache and the slabs at once, a cache holds at most twice as many
+    static constexpr u32 CACHE_BATCH_SIZE = 32;
+
+    SmallObjectAllocator();
+    ~SmallObjectAllocator();
+
+    // Larger sizes are passed on to the internal memory resource. Returns nullptr when out of memory.
+    void* Allocate(std::size_t size);
+
+    // Size has to be the size passed to Allocate.
+    void Free(void* memory, std::size_t size);
+
+    // Returns the objects cached by all threads and releases all empty slabs.
+    void Trim();
+
+    std::size_t GetSlabCount();
+
+    inline std::size_t GetReservedMemory() { return this->GetSlabCount() * ECS_SMALL_OBJECT_SLAB_SIZE; }
+
+private:
+    static inline u32 GetSizeClass(std::size_t size)
+    {
+        u32 sizeClass = 0;
+        while ((MIN_SIZE << sizeClass) < size)
+        {
+            ++sizeClass;
+        }
+
+        return sizeClass;
+    }
+
+    static inline std::size_t GetClassSize(u32 sizeClass) { return MIN_SIZE << sizeClass; }
+
+    // Links up to count free objects of a class in front of list, returns the number of objects taken.
+    u32 AllocateBatch(u32 sizeClass, void*& list, u32 count);
+
+    // Returns a null terminated list of objects of a class to their slabs.
+    void FreeBatch(u32 sizeClass, void* list);
+
+    void RegisterCache(SmallObjectCache* cache);
+    void UnregisterCache(SmallObjectCache* cache);
+
+    Slab* AcquireSlab(SizeClass& sizeClass, u32 sizeClassIndex);
+    void  ReleaseSlab(SizeClass& sizeClass, Slab* slab);
+    // Index of the slab holding object, the number of slabs if there is none.
+    std::size_t FindSlab(const SizeClass& sizeClass, const void* object) const;
+
+private:
+    SizeClass sizeClasses[NUM_SIZE_CLASSES];
+
+    // caches of the threads that allocated from this allocator
+    std::mutex                cachesMutex;
+    Vector<SmallObjectCache*> caches;
+
+    SmallObjectAllocator(const SmallObjectAllocator&) = delete;
+    SmallObjectAllocator& operator=(SmallObjectAllocator&) = delete;
+};
+
+} // namespace internal
+} // namespace memory
+} // namespace ecs
@@ -0,0 +1,234 @@
+#include "memory/virtual_memory.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cstdio>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+// overcommitted anyway where it is missing, e.g. on FreeBSD
+#if !defined(MAP_NORESERVE)
+#define MAP_NORESERVE 0
+#endif
+#endif
+
+#define ECS_DEFAULT_HUGE_PAGE_SIZE 2097152 // 2 MB
+
+namespace ecs::memory
+{
+
+#if defined(_WIN32)
+
+std::size_t GetVirtualMemoryPageSize()
+{
+    SYSTEM_INFO systemInfo;
+    ::GetSystemInfo(&systemInfo);
+    return static_cast<std::size_t>(systemInfo.dwPageSize);
+}
+
+std::size_t GetHugePageSize()
+{
+    const std::size_t largePageSize = ::GetLargePageMinimum();
+    return largePageSize > 0 ? largePageSize : ECS_DEFAULT_HUGE_PAGE_SIZE;
+}
+
+void* ReserveVirtualMemory(std::size_t size, u32 numaNode, bool* numaPlaced)
+{
+    if (numaPlaced != nullptr)
+    {
+        *numaPlaced = false;
+    }
+
+    // the node is taken when the range is reserved, committing pages of an existing range ignores it
+    if (numaNode != ANY_NUMA_NODE)
+    {
+        void* memory =
+            ::VirtualAllocExNuma(::GetCurrentProcess(), nullptr, size, MEM_RESERVE, PAGE_NOACCESS, (DWORD)numaNode);
+        if (memory != nullptr)
+        {
+            if (numaPlaced != nullptr)
+            {
+                *numaPlaced = true;
+            }
+            return memory;
+        }
+    }
+
+    return ::VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+void ReleaseVirtualMemory(void* memory, std::size_t)
+{
+    ::VirtualFree(memory, 0, MEM_RELEASE);
+}
+
+bool CommitVirtualMemory(void* memory, std::size_t size)
+{
+    return ::VirtualAlloc(memory, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+bool IsHugePageSupported()
+{
+    return false;
+}
+
+bool AdviseHugePages(void*, std::size_t)
+{
+    // large pages have to be committed at once and need the lock memory privilege
+    return false;
+}
+
+void DecommitVirtualMemory(void* memory, std::size_t size)
+{
+    // MEM_DECOMMIT would make the pages inaccessible, a reset only drops their content
+    ::VirtualAlloc(memory, size, MEM_RESET, PAGE_READWRITE);
+}
+
+#else
+
+std::size_t GetVirtualMemoryPageSize()
+{
+    return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+}
+
+std::size_t GetHugePageSize()
+{
+    std::size_t hugePageSize = 0;
+
+    FILE* file = std::fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+    if (file != nullptr)
+    {
+        unsigned long long size = 0;
+        if (std::fscanf(file, "%llu", &size) == 1)
+        {
+            hugePageSize = static_cast<std::size_t>(size);
+        }
+        std::fclose(file);
+    }
+
+    return hugePageSize > 0 ? hugePageSize : ECS_DEFAULT_HUGE_PAGE_SIZE;
+}
+
+namespace
+{
+
+bool BindToNumaNode(void* memory, std::size_t size, u32 node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    // MPOL_PREFERRED of <numaif.h>, called directly so that libnuma isn't needed
+    constexpr int           PREFERRED_POLICY = 1;
+    constexpr unsigned long MASK_WORD_BITS   = sizeof(unsigned long) * 8;
+
+    unsigned long nodeMask[16] = {};
+    if (node >= sizeof(nodeMask) * 8)
+    {
+        return false;
+    }
+
+    nodeMask[node / MASK_WORD_BITS] = 1UL << (node % MASK_WORD_BITS);
+
+    // the policy holds for pages committed later on, whichever thread touches them first; the kernel expects one
+    // bit more than the mask holds
+    return ::syscall(SYS_mbind, memory, size, PREFERRED_POLICY, nodeMask, sizeof(nodeMask) * 8 + 1, 0) == 0;
+#else
+    // no placement interface without libraries beyond POSIX
+    return false;
+#endif
+}
+
+} // namespace
+
+void* ReserveVirtualMemory(std::size_t size, u32 numaNode, bool* numaPlaced)
+{
+    void* memory = ::mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+    const bool placed = numaNode != ANY_NUMA_NODE && BindToNumaNode(memory, size, numaNode);
+    if (numaPlaced != nullptr)
+    {
+        *numaPlaced = placed;
+    }
+
+    return memory;
+}
+
+void ReleaseVirtualMemory(void* memory, std::size_t size)
+{
+    ::munmap(memory, size);
+}
+
+bool CommitVirtualMemory(void* memory, std::size_t size)
+{
+    return ::mprotect(memory, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+bool IsHugePageSupported()
+{
+#if defined(MADV_HUGEPAGE)
+    // "always [madvise] never", the advice is ignored if the selection is never
+    char enabled[64] = {};
+
+    FILE* file = std::fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    const bool read = std::fgets(enabled, sizeof(enabled), file) != nullptr;
+    std::fclose(file);
+
+    return read == true && std::strstr(enabled, "[never]") == nullptr;
+#else
+    return false;
+#endif
+}
+
+bool AdviseHugePages(void* memory, std::size_t size)
+{
+#if defined(MADV_HUGEPAGE)
+    return ::madvise(memory, size, MADV_HUGEPAGE) == 0;
+#else
+    return false;
+#endif
+}
+
+void DecommitVirtualMemory(void* memory, std::size_t size)
+{
+    // private anonymous pages read back as zero after this
+    ::madvise(memory, size, MADV_DONTNEED);
+}
+
+#endif
+
+void PrefaultVirtualMemory(void* memory, std::size_t size)
+{
+#if defined(__linux__) && defined(MADV_POPULATE_WRITE)
+    if (::madvise(memory, size, MADV_POPULATE_WRITE) == 0)
+    {
+        return;
+    }
+#endif
+
+    // write to every page, reading would only map the shared zero page
+    volatile u8*      bytes    = static_cast<volatile u8*>(memory);
+    const std::size_t pageSize = GetVirtualMemoryPageSize();
+    for (std::size_t offset = 0; offset < size; offset += pageSize)
+    {
+        bytes[offset] = bytes[offset];
+    }
+}
+
+} // namespace ecs::memory
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "api.h"
+
+namespace ecs
+{
+namespace memory
+{
+
+// Size of a virtual memory page, all functions below work on whole pages.
+ECS_API std::size_t GetVirtualMemoryPageSize();
+
+// Size of a transparent huge page, 2 MB where it can't be queried.
+ECS_API std::size_t GetHugePageSize();
+
+// No NUMA node preference, see ReserveVirtualMemory.
+static constexpr u32 ANY_NUMA_NODE = 0xFFFFFFFF;
+
+// Reserves an address range without backing it by memory, returns nullptr on failure. Given a NUMA node by its system
+// id, see util::GetNumaNodeId, the system is asked to place the pages later committed in the range on that node. They
+// go to other nodes when it is out of memory. numaPlaced tells whether the system took the request, the range is
+// reserved either way.
+ECS_API void* ReserveVirtualMemory(std::size_t size, u32 numaNode = ANY_NUMA_NODE, bool* numaPlaced = nullptr);
+
+// Returns a reserved range to the system.
+ECS_API void ReleaseVirtualMemory(void* memory, std::size_t size);
+
+// Makes reserved pages accessible, they are backed by memory on first touch.
+ECS_API bool CommitVirtualMemory(void* memory, std::size_t size);
+
+// Whether transparent huge pages can be requested for a range.
+ECS_API bool IsHugePageSupported();
+
+// Asks the system to back committed pages by huge pages, returns false where that is not supported.
+ECS_API bool AdviseHugePages(void* memory, std::size_t size);
+
+// Touches committed pages so that they are backed by memory right away.
+ECS_API void PrefaultVirtualMemory(void* memory, std::size_t size);
+
+// Gives the memory behind committed pages back to the system. The pages stay accessible, but their content is lost.
+ECS_API void DecommitVirtualMemory(void* memory, std::size_t size);
+
+} // namespace memory
+} // namespace ecs
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "api.h"
+#include "memory/memory_resource.h"
 
 #include <limits.h>
 
@@ -124,7 +125,7 @@ public:
 private:
     using TableEntry = std::pair<typename Handle::value_type, T*>;
 
-    std::vector<TableEntry> m_Table;
+    memory::internal::Vector<TableEntry> m_Table;
 
     void GrowTable()
     {
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <cstring>
+
+#include "api.h"
+
+namespace ecs::util
+{
+
+// fixed 64-bit even on 32-bit targets, where ecs::u64 is 32 bits wide
+using HashValue = uint64_t;
+
+namespace internal
+{
+static constexpr HashValue HASH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+static constexpr HashValue HASH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr HashValue HASH_PRIME_3 = 0x165667B19E3779F9ULL;
+static constexpr HashValue HASH_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+
+static inline HashValue Rotl64(HashValue x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline HashValue HashRound(HashValue acc, HashValue input)
+{
+    acc += input * HASH_PRIME_2;
+    acc = Rotl64(acc, 31);
+    return acc * HASH_PRIME_1;
+}
+
+static inline HashValue Read64(const u8* p)
+{
+    HashValue v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+} // namespace internal
+
+/**
+ * Combines two hash values.
+ */
+static inline HashValue HashCombine(HashValue seed, HashValue value)
+{
+    seed ^= internal::HashRound(0, value);
+    return seed * internal::HASH_PRIME_1 + internal::HASH_PRIME_4;
+}
+
+namespace internal
+{
+static inline HashValue MergeLanes(HashValue v1, HashValue v2, HashValue v3, HashValue v4)
+{
+    HashValue h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+    h           = HashCombine(h, v1);
+    h           = HashCombine(h, v2);
+    h           = HashCombine(h, v3);
+    h           = HashCombine(h, v4);
+    return h;
+}
+
+// mixes the last bytes, less than 32, into h and finalizes it
+static inline HashValue HashTail(HashValue h, const u8* p, const u8* const end)
+{
+    for (; p + 8 <= end; p += 8)
+    {
+        h ^= HashRound(0, Read64(p));
+        h = Rotl64(h, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+    }
+
+    for (; p < end; ++p)
+    {
+        h ^= (*p) * HASH_PRIME_3;
+        h = Rotl64(h, 11) * HASH_PRIME_1;
+    }
+
+    h ^= h >> 33;
+    h *= HASH_PRIME_2;
+    h ^= h >> 29;
+    h *= HASH_PRIME_3;
+    h ^= h >> 32;
+    return h;
+}
+} // namespace internal
+
+/**
+ * Hashes a block of memory. The main loop keeps four independent 64-bit lanes so
+ * the compiler can pipeline or vectorize it over large chunks.
+ * @param data - Start of the memory block.
+ * @param size - Size of the memory block in bytes.
+ * @param seed - Hash seed, e.g. the hash of the previous block.
+ * @return The hash value.
+ */
+static inline HashValue HashBytes(const void* data, std::size_t size, HashValue seed = 0)
+{
+    using namespace internal;
+
+    const u8*       p   = static_cast<const u8*>(data);
+    const u8* const end = p + size;
+    HashValue       h;
+
+    if (size >= 32)
+    {
+        HashValue v1 = seed + HASH_PRIME_1 + HASH_PRIME_2;
+        HashValue v2 = seed + HASH_PRIME_2;
+        HashValue v3 = seed;
+        HashValue v4 = seed - HASH_PRIME_1;
+
+        const u8* const limit = end - 32;
+        do
+        {
+            v1 = HashRound(v1, Read64(p));
+            v2 = HashRound(v2, Read64(p + 8));
+            v3 = HashRound(v3, Read64(p + 16));
+            v4 = HashRound(v4, Read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+
+        h = MergeLanes(v1, v2, v3, v4);
+    }
+    else
+    {
+        h = seed + HASH_PRIME_3;
+    }
+
+    h += static_cast<HashValue>(size);
+
+    return HashTail(h, p, end);
+}
+
+// Summary:	Hashes a sequence of memory blocks as if they were one, e.g. many
+// small objects without setting up and finalizing a hash for each of them.
+// The result equals HashBytes over the concatenated blocks.
+class HashStream
+{
+public:
+    explicit HashStream(HashValue seed = 0)
+        : v1(seed + internal::HASH_PRIME_1 + internal::HASH_PRIME_2)
+        , v2(seed + internal::HASH_PRIME_2)
+        , v3(seed)
+        , v4(seed - internal::HASH_PRIME_1)
+        , seed(seed)
+        , totalSize(0)
+        , bufferSize(0)
+    {
+    }
+
+    inline void Update(const void* data, std::size_t size)
+    {
+        const u8*       p   = static_cast<const u8*>(data);
+        const u8* const end = p + size;
+
+        this->totalSize += size;
+
+        if (this->bufferSize + size < sizeof(this->buffer))
+        {
+            std::memcpy(this->buffer + this->bufferSize, p, size);
+            this->bufferSize += size;
+            return;
+        }
+
+        if (this->bufferSize > 0)
+        {
+            const std::size_t fill = sizeof(this->buffer) - this->bufferSize;
+            std::memcpy(this->buffer + this->bufferSize, p, fill);
+            this->Consume(this->buffer);
+            p += fill;
+            this->bufferSize = 0;
+        }
+
+        for (; p + sizeof(this->buffer) <= end; p += sizeof(this->buffer))
+        {
+            this->Consume(p);
+        }
+
+        this->bufferSize = static_cast<std::size_t>(end - p);
+        std::memcpy(this->buffer, p, this->bufferSize);
+    }
+
+    HashValue Finalize() const
+    {
+        HashValue h = this->totalSize >= sizeof(this->buffer)
+                          ? internal::MergeLanes(this->v1, this->v2, this->v3, this->v4)
+                          : this->seed + internal::HASH_PRIME_3;
+
+        h += static_cast<HashValue>(this->totalSize);
+
+        return internal::HashTail(h, this->buffer, this->buffer + this->bufferSize);
+    }
+
+private:
+    inline void Consume(const u8* p)
+    {
+        this->v1 = internal::HashRound(this->v1, internal::Read64(p));
+        this->v2 = internal::HashRound(this->v2, internal::Read64(p + 8));
+        this->v3 = internal::HashRound(this->v3, internal::Read64(p + 16));
+        this->v4 = internal::HashRound(this->v4, internal::Read64(p + 24));
+    }
+
+private:
+    HashValue   v1;
+    HashValue   v2;
+    HashValue   v3;
+    HashValue   v4;
+    HashValue   seed;
+    std::size_t totalSize;
+    std::size_t bufferSize;
+    u8          buffer[32];
+};
+
+} // namespace ecs::util
@@ -0,0 +1,253 @@
+#include "util/mapped_file.h"
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ecs::util
+{
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile()
+    : data(nullptr)
+    , size(0)
+    , writable(false)
+    , file(INVALID_HANDLE_VALUE)
+    , mapping(nullptr)
+{
+}
+
+bool MappedFile::Create(const char* path, std::size_t size)
+{
+    this->Close();
+
+    this->file = ::CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                               FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (this->file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    this->writable = true;
+    return this->Map(size);
+}
+
+bool MappedFile::Open(const char* path)
+{
+    this->Close();
+
+    this->file = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                               nullptr);
+    if (this->file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (::GetFileSizeEx(this->file, &fileSize) == FALSE || fileSize.QuadPart == 0)
+    {
+        ::CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    this->writable = false;
+    return this->Map(static_cast<std::size_t>(fileSize.QuadPart));
+}
+
+bool MappedFile::Map(std::size_t size)
+{
+    const DWORD protect = this->writable ? PAGE_READWRITE : PAGE_WRITECOPY;
+    const DWORD access  = this->writable ? FILE_MAP_WRITE : FILE_MAP_COPY;
+
+    // a writable mapping extends the file to its size
+    this->mapping = ::CreateFileMappingA(this->file, nullptr, protect, static_cast<DWORD>((u64)size >> 32),
+                                         static_cast<DWORD>(size & 0xFFFFFFFF), nullptr);
+    if (this->mapping == nullptr)
+    {
+        return false;
+    }
+
+    this->data = static_cast<u8*>(::MapViewOfFile(this->mapping, access, 0, 0, size));
+    if (this->data == nullptr)
+    {
+        ::CloseHandle(this->mapping);
+        this->mapping = nullptr;
+        return false;
+    }
+
+    this->size = size;
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (this->data != nullptr)
+    {
+        ::UnmapViewOfFile(this->data);
+        this->data = nullptr;
+    }
+
+    if (this->mapping != nullptr)
+    {
+        ::CloseHandle(this->mapping);
+        this->mapping = nullptr;
+    }
+}
+
+void MappedFile::Close(std::size_t size)
+{
+    this->Unmap();
+
+    if (this->file != INVALID_HANDLE_VALUE)
+    {
+        if (this->writable == true)
+        {
+            LARGE_INTEGER fileSize;
+            fileSize.QuadPart = static_cast<LONGLONG>(size);
+            ::SetFilePointerEx(this->file, fileSize, nullptr, FILE_BEGIN);
+            ::SetEndOfFile(this->file);
+        }
+
+        ::CloseHandle(this->file);
+        this->file = INVALID_HANDLE_VALUE;
+    }
+
+    this->size     = 0;
+    this->writable = false;
+}
+
+#else
+
+MappedFile::MappedFile()
+    : data(nullptr)
+    , size(0)
+    , writable(false)
+    , file(-1)
+{
+}
+
+bool MappedFile::Create(const char* path, std::size_t size)
+{
+    this->Close();
+
+    this->file = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (this->file < 0)
+    {
+        return false;
+    }
+
+    this->writable = true;
+    return this->Map(size);
+}
+
+bool MappedFile::Open(const char* path)
+{
+    this->Close();
+
+    this->file = ::open(path, O_RDONLY);
+    if (this->file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (::fstat(this->file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        ::close(this->file);
+        this->file = -1;
+        return false;
+    }
+
+    this->writable = false;
+    return this->Map(static_cast<std::size_t>(fileStat.st_size));
+}
+
+bool MappedFile::Map(std::size_t size)
+{
+    if (this->writable == true && ::ftruncate(this->file, static_cast<off_t>(size)) != 0)
+    {
+        return false;
+    }
+
+    // read-only files are mapped privately, writes only touch the process' copy of a page
+    const int flags = this->writable ? MAP_SHARED : MAP_PRIVATE;
+
+    void* pMem = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, this->file, 0);
+    if (pMem == MAP_FAILED)
+    {
+        return false;
+    }
+
+    this->data = static_cast<u8*>(pMem);
+    this->size = size;
+    return true;
+}
+
+void MappedFile::Unmap()
+{
+    if (this->data != nullptr)
+    {
+        ::munmap(this->data, this->size);
+        this->data = nullptr;
+    }
+}
+
+void MappedFile::Close(std::size_t size)
+{
+    this->Unmap();
+
+    if (this->file >= 0)
+    {
+        if (this->writable == true)
+        {
+            // on failure the file only keeps unused space behind the data
+            const int result = ::ftruncate(this->file, static_cast<off_t>(size));
+            (void)result;
+        }
+
+        ::close(this->file);
+        this->file = -1;
+    }
+
+    this->size     = 0;
+    this->writable = false;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    this->Close();
+}
+
+bool MappedFile::Resize(std::size_t size)
+{
+    assert(this->writable == true && "Only writable mappings can be resized.");
+
+    const std::size_t oldSize = this->size;
+
+    this->Unmap();
+    if (this->Map(size) == true)
+    {
+        return true;
+    }
+
+    // keep the old mapping usable
+    this->Map(oldSize);
+    return false;
+}
+
+} // namespace ecs::util
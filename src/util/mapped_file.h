@@ -0,0 +1,54 @@
+#pragma once
+
+#include "api.h"
+
+namespace ecs::util
+{
+
+// Summary:	File mapped into memory, either read-only or read-write. A writable mapping can be resized, which remaps
+//			the file, pointers into the old mapping are invalidated.
+class ECS_API MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    // Creates or truncates path and maps size bytes of it for writing.
+    bool Create(const char* path, std::size_t size);
+
+    // Maps an existing file copy-on-write, changes to the mapping are not written back.
+    bool Open(const char* path);
+
+    // Changes the size of a writable mapping, the content up to the smaller size is kept.
+    bool Resize(std::size_t size);
+
+    // Unmaps the file and truncates a writable file to size bytes.
+    void Close(std::size_t size);
+
+    inline void Close() { this->Close(this->size); }
+
+    inline bool        IsOpen() const { return this->data != nullptr; }
+    inline u8*         GetData() const { return this->data; }
+    inline std::size_t GetSize() const { return this->size; }
+
+private:
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Map(std::size_t size);
+    void Unmap();
+
+private:
+    u8*         data;
+    std::size_t size;
+    bool        writable;
+
+#if defined(_WIN32)
+    void* file;
+    void* mapping;
+#else
+    int file;
+#endif
+};
+
+} // namespace ecs::util
@@ -0,0 +1,241 @@
+#include "util/numa.h"
+
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <cstdio>
+#include <cstdlib>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ecs::util
+{
+
+namespace
+{
+
+using NumaNodeIds = std::vector<u32>;
+
+#if defined(_WIN32)
+
+NumaNodeIds ReadNumaNodeIds()
+{
+    NumaNodeIds nodeIds;
+
+    ULONG highestNode = 0;
+    if (::GetNumaHighestNodeNumber(&highestNode))
+    {
+        for (ULONG node = 0; node <= highestNode; ++node)
+        {
+            ULONGLONG availableMemory = 0;
+            if (::GetNumaAvailableMemoryNodeEx(static_cast<USHORT>(node), &availableMemory) && availableMemory > 0)
+            {
+                nodeIds.push_back(static_cast<u32>(node));
+            }
+        }
+    }
+
+    return nodeIds;
+}
+
+#elif defined(__linux__)
+
+// Reads a list like "0-3,8-11" of a sysfs file and calls range(first, last) for each of its ranges.
+template <class F>
+bool ReadRangeList(const char* path, F range)
+{
+    char text[4096] = {};
+
+    FILE* file = std::fopen(path, "r");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    const bool read = std::fgets(text, sizeof(text), file) != nullptr;
+    std::fclose(file);
+
+    if (read == false)
+    {
+        return false;
+    }
+
+    char* position = text;
+    while (*position >= '0' && *position <= '9')
+    {
+        const unsigned long first = std::strtoul(position, &position, 10);
+        unsigned long       last  = first;
+        if (*position == '-')
+        {
+            last = std::strtoul(position + 1, &position, 10);
+        }
+
+        range(first, last);
+
+        if (*position == ',')
+        {
+            ++position;
+        }
+    }
+
+    return true;
+}
+
+NumaNodeIds ReadNumaNodeIds()
+{
+    NumaNodeIds nodeIds;
+
+    const auto addNodes = [&](unsigned long first, unsigned long last) {
+        for (unsigned long node = first; node <= last; ++node)
+        {
+            nodeIds.push_back(static_cast<u32>(node));
+        }
+    };
+
+    // kernels without memory hotplug support lack has_memory, all their online nodes have memory
+    if (ReadRangeList("/sys/devices/system/node/has_memory", addNodes) == false || nodeIds.empty() == true)
+    {
+        nodeIds.clear();
+        ReadRangeList("/sys/devices/system/node/online", addNodes);
+    }
+
+    return nodeIds;
+}
+
+#else
+
+// no topology interface, e.g. on macOS, the machine is treated as a single node
+NumaNodeIds ReadNumaNodeIds()
+{
+    return NumaNodeIds();
+}
+
+#endif
+
+// the topology doesn't change while the process runs
+const NumaNodeIds& GetNumaNodeIds()
+{
+    static const NumaNodeIds nodeIds = []() {
+        NumaNodeIds ids = ReadNumaNodeIds();
+        if (ids.empty() == true)
+        {
+            ids.push_back(0);
+        }
+        return ids;
+    }();
+
+    return nodeIds;
+}
+
+#if defined(_WIN32) || defined(__linux__)
+
+// node of a system id, 0 for nodes without memory
+u32 FindNumaNode(u32 nodeId)
+{
+    const NumaNodeIds& nodeIds = GetNumaNodeIds();
+    for (u32 node = 0; node < nodeIds.size(); ++node)
+    {
+        if (nodeIds[node] == nodeId)
+        {
+            return node;
+        }
+    }
+
+    return 0;
+}
+
+#endif
+
+} // namespace
+
+u32 GetNumaNodeCount()
+{
+    return static_cast<u32>(GetNumaNodeIds().size());
+}
+
+u32 GetNumaNodeId(u32 node)
+{
+    const NumaNodeIds& nodeIds = GetNumaNodeIds();
+    return nodeIds[node % nodeIds.size()];
+}
+
+#if defined(_WIN32)
+
+u32 GetCurrentNumaNode()
+{
+    PROCESSOR_NUMBER processor;
+    ::GetCurrentProcessorNumberEx(&processor);
+
+    USHORT nodeId = 0;
+    return ::GetNumaProcessorNodeEx(&processor, &nodeId) ? FindNumaNode(static_cast<u32>(nodeId)) : 0;
+}
+
+bool PinCurrentThreadToNumaNode(u32 node)
+{
+    GROUP_AFFINITY affinity = {};
+    if (!::GetNumaNodeProcessorMaskEx(static_cast<USHORT>(GetNumaNodeId(node)), &affinity) || affinity.Mask == 0)
+    {
+        return false;
+    }
+
+    return ::SetThreadGroupAffinity(::GetCurrentThread(), &affinity, nullptr) != 0;
+}
+
+#elif defined(__linux__)
+
+u32 GetCurrentNumaNode()
+{
+    unsigned int cpu    = 0;
+    unsigned int nodeId = 0;
+    return ::syscall(SYS_getcpu, &cpu, &nodeId, nullptr) == 0 ? FindNumaNode(static_cast<u32>(nodeId)) : 0;
+}
+
+bool PinCurrentThreadToNumaNode(u32 node)
+{
+    char path[64];
+    std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", GetNumaNodeId(node));
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    const bool read = ReadRangeList(path, [&](unsigned long first, unsigned long last) {
+        for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+        {
+            CPU_SET(cpu, &cpus);
+        }
+    });
+
+    if (read == false || CPU_COUNT(&cpus) == 0)
+    {
+        return false;
+    }
+
+    // 0 is the calling thread
+    return ::sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+#else
+
+u32 GetCurrentNumaNode()
+{
+    return 0;
+}
+
+bool PinCurrentThreadToNumaNode(u32)
+{
+    return false;
+}
+
+#endif
+
+} // namespace ecs::util
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "api.h"
+
+namespace ecs::util
+{
+
+// Number of NUMA nodes with memory, 1 where the topology can't be queried. Offline and memoryless nodes are left out,
+// the remaining ones are numbered from 0, see GetNumaNodeId.
+ECS_API u32 GetNumaNodeCount();
+
+// System id of a node, e.g. for the system's memory policy calls.
+ECS_API u32 GetNumaNodeId(u32 node);
+
+// Node of the processor the calling thread currently runs on, 0 where it can't be queried or that node has no memory.
+ECS_API u32 GetCurrentNumaNode();
+
+// Restricts the calling thread to the processors of a node, returns false if the node has none or that fails.
+ECS_API bool PinCurrentThreadToNumaNode(u32 node);
+
+} // namespace ecs::util
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "api.h"
+
+namespace ecs::util
+{
+
+// Summary:	Non-owning view of a contiguous range of objects.
+template <typename T>
+class Span
+{
+public:
+    using element_type = T;
+    using iterator     = T*;
+
+    Span()
+        : first(nullptr)
+        , count(0)
+    {
+    }
+
+    Span(T* first, std::size_t count)
+        : first(first)
+        , count(count)
+    {
+    }
+
+    inline T*          data() const { return this->first; }
+    inline std::size_t size() const { return this->count; }
+    inline bool        empty() const { return this->count == 0; }
+
+    inline T& operator[](std::size_t index) const
+    {
+        assert(index < this->count && "Span index out of range.");
+        return this->first[index];
+    }
+
+    inline iterator begin() const { return this->first; }
+    inline iterator end() const { return this->first + this->count; }
+
+private:
+    T*          first;
+    std::size_t count;
+};
+
+} // namespace ecs::util
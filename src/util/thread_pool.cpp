@@ -0,0 +1,205 @@
+#include "util/thread_pool.h"
+
+#include "util/numa.h"
+
+namespace ecs::util
+{
+
+namespace
+{
+thread_local std::size_t currentWorkerIndex = 0;
+thread_local ThreadPool* currentThreadPool  = nullptr;
+}
+
+ThreadPool::ThreadPool(std::size_t numWorkers, bool pinToNumaNodes)
+    : job(nullptr)
+    , numNodes(pinToNumaNodes == true ? util::GetNumaNodeCount() : 1)
+    , numActiveQueues(1)
+    , ordered(false)
+    , numBusyWorkers(0)
+    , generation(0)
+    , running(false)
+    , stop(false)
+{
+    this->jobQueues.reset(new JobQueue[this->numNodes]);
+    for (u32 i = 0; i < this->numNodes; ++i)
+    {
+        this->jobQueues[i].next.store(0, std::memory_order_relaxed);
+        this->jobQueues[i].end = 0;
+    }
+
+    this->workers.reserve(numWorkers);
+    for (std::size_t i = 0; i < numWorkers; ++i)
+    {
+        this->workers.emplace_back(&ThreadPool::WorkerMain, this, i + 1);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stop = true;
+    }
+    this->wakeCondition.notify_all();
+
+    for (std::thread& worker : this->workers)
+    {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::GetCurrentWorkerIndex()
+{
+    return currentWorkerIndex;
+}
+
+ThreadPool* ThreadPool::GetCurrentThreadPool()
+{
+    return currentThreadPool;
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const Job& job)
+{
+    assert(this->running == false && "ThreadPool::ParallelFor called from inside a job.");
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    if (count == 1 || this->workers.empty() == true)
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            job(i);
+        }
+        return;
+    }
+
+    this->jobQueues[0].next.store(0, std::memory_order_relaxed);
+    this->jobQueues[0].end = count;
+
+    this->Run(job, 1, false);
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const Job& job, const JobNode& jobNode)
+{
+    assert(this->running == false && "ThreadPool::ParallelFor called from inside a job.");
+
+    if (this->numNodes == 1 || count <= 1 || this->workers.empty() == true)
+    {
+        this->ParallelFor(count, job);
+        return;
+    }
+
+    // counting sort of the jobs by node, they stay in ascending order within a node
+    this->jobOrder.resize(count);
+    this->jobNodes.resize(count);
+
+    for (u32 node = 0; node < this->numNodes; ++node)
+    {
+        this->jobQueues[node].end = 0;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        this->jobNodes[i] = jobNode(i) % this->numNodes;
+        ++this->jobQueues[this->jobNodes[i]].end;
+    }
+
+    std::size_t begin = 0;
+    for (u32 node = 0; node < this->numNodes; ++node)
+    {
+        const std::size_t nodeCount = this->jobQueues[node].end;
+        this->jobQueues[node].next.store(begin, std::memory_order_relaxed);
+        this->jobQueues[node].end = begin;
+        begin += nodeCount;
+    }
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        this->jobOrder[this->jobQueues[this->jobNodes[i]].end++] = i;
+    }
+
+    this->Run(job, this->numNodes, true);
+}
+
+void ThreadPool::Run(const Job& job, u32 numQueues, bool ordered)
+{
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->job             = &job;
+        this->numActiveQueues = numQueues;
+        this->ordered         = ordered;
+        this->numBusyWorkers  = this->workers.size();
+        this->running         = true;
+        ++this->generation;
+    }
+    this->wakeCondition.notify_all();
+
+    // the calling thread isn't pinned, it may have moved since the last call
+    this->RunJobs(numQueues > 1 ? util::GetCurrentNumaNode() : 0);
+
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->doneCondition.wait(lock, [this]() { return this->numBusyWorkers == 0; });
+
+    this->job     = nullptr;
+    this->running = false;
+}
+
+void ThreadPool::WorkerMain(std::size_t workerIndex)
+{
+    currentWorkerIndex = workerIndex;
+    currentThreadPool  = this;
+
+    // workers are spread over the nodes in turn, the first one next to the engine thread's usual node 0
+    const u32 node = static_cast<u32>(workerIndex % this->numNodes);
+    if (this->numNodes > 1)
+    {
+        util::PinCurrentThreadToNumaNode(node);
+    }
+
+    u64 lastGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wakeCondition.wait(lock,
+                                     [&]() { return this->stop == true || this->generation != lastGeneration; });
+
+            if (this->stop == true)
+            {
+                return;
+            }
+
+            lastGeneration = this->generation;
+        }
+
+        this->RunJobs(node);
+
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            --this->numBusyWorkers;
+        }
+        this->doneCondition.notify_one();
+    }
+}
+
+void ThreadPool::RunJobs(u32 node)
+{
+    // the own node's queue first, then the others in turn
+    for (u32 n = 0; n < this->numActiveQueues; ++n)
+    {
+        JobQueue& queue = this->jobQueues[(node + n) % this->numActiveQueues];
+
+        std::size_t i = queue.next.fetch_add(1, std::memory_order_relaxed);
+        while (i < queue.end)
+        {
+            (*this->job)(this->ordered == true ? this->jobOrder[i] : i);
+            i = queue.next.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace ecs::util
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "api.h"
+
+#include "memory/memory_resource.h"
+
+namespace ecs::util
+{
+
+// Summary:	Fixed set of worker threads that run index ranges of jobs. The calling thread takes part in every
+//			ParallelFor, so a pool without workers runs everything inline. Workers can be pinned to the machine's
+//			NUMA nodes in turn, jobs are then preferably run on the node of the memory they work on.
+class ECS_API ThreadPool
+{
+    // Summary:	Jobs of one NUMA node, [next, end) of the job order are not taken yet.
+    struct JobQueue
+    {
+        std::atomic<std::size_t> next;
+        std::size_t              end;
+    };
+
+public:
+    using Job     = std::function<void(std::size_t)>;
+    using JobNode = std::function<u32(std::size_t)>;
+
+    explicit ThreadPool(std::size_t numWorkers, bool pinToNumaNodes = false);
+    ~ThreadPool();
+
+    // Runs job(i) for every i in [0, count) and returns once all of them finished. Jobs are picked in ascending
+    // order, but may finish in any order. Must not be called from inside a job.
+    void ParallelFor(std::size_t count, const Job& job);
+
+    // Like ParallelFor, but job(i) preferably runs on a thread of NUMA node jobNode(i). Threads take the jobs of
+    // their own node first and help out with those of the other nodes once it has none left.
+    void ParallelFor(std::size_t count, const Job& job, const JobNode& jobNode);
+
+    inline std::size_t GetWorkerCount() const { return this->workers.size(); }
+
+    // Nodes the workers are pinned to, 1 if they aren't pinned.
+    inline u32 GetNumaNodeCount() const { return this->numNodes; }
+
+    // Index of the calling thread, 0 for threads outside the pool and 1..GetWorkerCount() for the workers.
+    static std::size_t GetCurrentWorkerIndex();
+
+    // Pool the calling thread is a worker of, nullptr for threads outside any pool.
+    static ThreadPool* GetCurrentThreadPool();
+
+private:
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void WorkerMain(std::size_t workerIndex);
+
+    // Publishes the jobs set up in the queues to the workers, runs them and waits for all of them.
+    void Run(const Job& job, u32 numQueues, bool ordered);
+
+    void RunJobs(u32 node);
+
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    const Job* job;
+    // one per node, a ParallelFor without nodes only uses the first
+    std::unique_ptr<JobQueue[]> jobQueues;
+    u32                         numNodes;
+    u32                         numActiveQueues;
+    // job indices grouped by node, queues index into it when the jobs are ordered
+    memory::internal::Vector<std::size_t> jobOrder;
+    memory::internal::Vector<u32>         jobNodes;
+    bool                                  ordered;
+    // workers that did not finish the current ParallelFor yet
+    std::size_t numBusyWorkers;
+    u64         generation;
+    bool        running;
+    bool        stop;
+};
+
+} // namespace ecs::util
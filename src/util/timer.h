@@ -10,12 +10,16 @@ class ECS_API Timer
     using Elapsed = std::chrono::duration<f32, std::milli>;
 
 public:
-    Timer()  = default;
+    Timer()
+        : m_Elapsed(0)
+    {
+    }
     ~Timer() = default;
 
-    void Tick(f32 ms){};
+    // Advances the elapsed time by ms milliseconds.
+    inline void Tick(f32 ms) { this->m_Elapsed += Elapsed(ms); }
 
-    void Reset(){};
+    inline void Reset() { this->m_Elapsed = Elapsed::zero(); }
 
     [[nodiscard]] inline TimeStamp GetTimeStamp() const { return TimeStamp(this->m_Elapsed.count()); }
 
@@ -0,0 +1,266 @@
+#pragma once
+
+#include "api.h"
+
+#include "memory/memory_resource.h"
+#include "util/handle.h"
+
+namespace ecs::util
+{
+
+using TimerHandle = Handle64;
+
+static const TimerHandle INVALID_TIMER_HANDLE = Handle64::INVALID_HANDLE;
+
+// Summary:	Hierarchical timer wheel with a resolution of one tick. Scheduling and cancelling are O(1), advancing costs
+//			O(1) per tick plus the expired timers. Timers further away than the wheel spans are parked in the last
+//			level and re-inserted until they are in range. Timers expiring on the same tick fire in an unspecified but
+//			deterministic order.
+template <typename T>
+class TimerWheel
+{
+    static constexpr u32 SLOT_BITS  = 6;
+    static constexpr u32 NUM_SLOTS  = 1U << SLOT_BITS;
+    static constexpr u32 SLOT_MASK  = NUM_SLOTS - 1;
+    static constexpr u32 NUM_LEVELS = 4;
+    static constexpr u64 MAX_DELAY  = (u64)1 << (SLOT_BITS * NUM_LEVELS);
+
+    static constexpr u32 INVALID_NODE = std::numeric_limits<u32>::max();
+
+    struct Node
+    {
+        u64 expires;
+        u32 prev;
+        u32 next;
+        u32 slot;
+        u32 version;
+        T   value;
+    };
+
+    // doubly linked list of nodes, new nodes are appended
+    struct Slot
+    {
+        u32 head;
+        u32 tail;
+    };
+
+public:
+    TimerWheel()
+        : currentTick(0)
+        , freeNode(INVALID_NODE)
+        , numTimers(0)
+    {
+        for (Slot& slot : this->slots)
+        {
+            slot = Slot{ INVALID_NODE, INVALID_NODE };
+        }
+    }
+
+    ~TimerWheel() = default;
+
+    // Schedules value to expire delay ticks from now, at least one tick.
+    TimerHandle Schedule(u64 delay, T value)
+    {
+        u32 node = this->freeNode;
+        if (node != INVALID_NODE)
+        {
+            this->freeNode = this->nodes[node].next;
+        }
+        else
+        {
+            assert(this->nodes.size() < TimerHandle::MAX_INDICES && "Too many timers.");
+
+            node = static_cast<u32>(this->nodes.size());
+            this->nodes.push_back(Node{ 0, INVALID_NODE, INVALID_NODE, INVALID_NODE, 0, T() });
+        }
+
+        Node& n    = this->nodes[node];
+        n.expires  = this->currentTick + (delay > 0 ? delay : 1);
+        n.value    = std::move(value);
+        n.version  = n.version < TimerHandle::MAX_VERSION ? n.version + 1 : 1;
+        ++this->numTimers;
+
+        this->Insert(node);
+        return TimerHandle(node, n.version);
+    }
+
+    // Removes a pending timer and moves its value out. Returns false if the timer already expired or was cancelled.
+    bool Cancel(TimerHandle handle, T& value)
+    {
+        if (this->IsPending(handle) == false)
+        {
+            return false;
+        }
+
+        const u32 node = static_cast<u32>(handle.index);
+
+        this->Unlink(node);
+        value = std::move(this->nodes[node].value);
+        this->Release(node);
+        return true;
+    }
+
+    inline bool IsPending(TimerHandle handle) const
+    {
+        return handle != INVALID_TIMER_HANDLE && handle.index < this->nodes.size() &&
+               this->nodes[handle.index].slot != INVALID_NODE && this->nodes[handle.index].version == handle.version;
+    }
+
+    // Advances the wheel to tick and passes the value of every expired timer to onExpired, in order of expiry.
+    // onExpired may schedule and cancel timers.
+    template <typename Callback>
+    void Advance(u64 tick, Callback&& onExpired)
+    {
+        while (this->currentTick < tick)
+        {
+            if (this->numTimers == 0)
+            {
+                this->currentTick = tick;
+                break;
+            }
+
+            ++this->currentTick;
+
+            // move the timers of the higher level slots that start at this tick one level down
+            for (u32 level = 1; level < NUM_LEVELS; ++level)
+            {
+                if ((this->currentTick & (((u64)1 << (SLOT_BITS * level)) - 1)) != 0)
+                {
+                    break;
+                }
+
+                this->Cascade(level * NUM_SLOTS + ((this->currentTick >> (SLOT_BITS * level)) & SLOT_MASK));
+            }
+
+            // collect first, callbacks may change the wheel
+            Slot& slot = this->slots[this->currentTick & SLOT_MASK];
+            while (slot.head != INVALID_NODE)
+            {
+                const u32 node = slot.head;
+                this->Unlink(node);
+
+                this->expired.push_back(std::move(this->nodes[node].value));
+                this->Release(node);
+            }
+
+            for (std::size_t i = 0; i < this->expired.size(); ++i)
+            {
+                onExpired(std::move(this->expired[i]));
+            }
+            this->expired.clear();
+        }
+    }
+
+    // Removes all timers and passes their values to onCancelled.
+    template <typename Callback>
+    void Clear(Callback&& onCancelled)
+    {
+        for (Slot& slot : this->slots)
+        {
+            while (slot.head != INVALID_NODE)
+            {
+                const u32 node = slot.head;
+                this->Unlink(node);
+
+                onCancelled(std::move(this->nodes[node].value));
+                this->Release(node);
+            }
+        }
+    }
+
+    inline u64         GetCurrentTick() const { return this->currentTick; }
+    inline std::size_t GetTimerCount() const { return this->numTimers; }
+
+private:
+    void Insert(u32 node)
+    {
+        Node&     n     = this->nodes[node];
+        const u64 delta = n.expires - this->currentTick;
+
+        // the level is chosen by the distance, the slot by the absolute expiry so cascading keeps it in place
+        u32 level   = 0;
+        u64 expires = delta < MAX_DELAY ? n.expires : this->currentTick + MAX_DELAY - 1;
+        while (level < NUM_LEVELS - 1 && (expires - this->currentTick) >= ((u64)1 << (SLOT_BITS * (level + 1))))
+        {
+            ++level;
+        }
+
+        n.slot = level * NUM_SLOTS + static_cast<u32>((expires >> (SLOT_BITS * level)) & SLOT_MASK);
+
+        Slot& slot = this->slots[n.slot];
+        n.prev     = slot.tail;
+        n.next     = INVALID_NODE;
+
+        if (slot.tail != INVALID_NODE)
+        {
+            this->nodes[slot.tail].next = node;
+        }
+        else
+        {
+            slot.head = node;
+        }
+        slot.tail = node;
+    }
+
+    void Unlink(u32 node)
+    {
+        Node& n    = this->nodes[node];
+        Slot& slot = this->slots[n.slot];
+
+        if (n.prev != INVALID_NODE)
+        {
+            this->nodes[n.prev].next = n.next;
+        }
+        else
+        {
+            slot.head = n.next;
+        }
+
+        if (n.next != INVALID_NODE)
+        {
+            this->nodes[n.next].prev = n.prev;
+        }
+        else
+        {
+            slot.tail = n.prev;
+        }
+
+        n.slot = INVALID_NODE;
+    }
+
+    void Release(u32 node)
+    {
+        Node& n        = this->nodes[node];
+        n.value        = T();
+        n.next         = this->freeNode;
+        this->freeNode = node;
+        --this->numTimers;
+    }
+
+    void Cascade(u32 slotIndex)
+    {
+        Slot& slot = this->slots[slotIndex];
+
+        u32 node  = slot.head;
+        slot.head = INVALID_NODE;
+        slot.tail = INVALID_NODE;
+
+        while (node != INVALID_NODE)
+        {
+            const u32 next = this->nodes[node].next;
+            this->Insert(node);
+            node = next;
+        }
+    }
+
+private:
+    Slot                           slots[NUM_LEVELS * NUM_SLOTS];
+    memory::internal::Vector<Node> nodes;
+    memory::internal::Vector<T>    expired;
+    u64                            currentTick;
+    u32                            freeNode;
+    std::size_t                    numTimers;
+
+}; // class TimerWheel
+
+} // namespace ecs::util